@@ -0,0 +1,127 @@
+#include <raylib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "headers/archive.hpp"
+
+// Packs everything in assets/ into assets.pak. The game prefers the archive
+// over the loose files when it's there, so run this again after changing
+// anything in assets/.
+
+const char* ASSET_DIRECTORY("./assets");
+
+struct PackedFile {
+  std::string name;
+  unsigned char* data;
+  unsigned int size;
+};
+
+uint64_t AlignOffset(uint64_t offset) {
+  return (offset + ARCHIVE_ALIGNMENT - 1) / ARCHIVE_ALIGNMENT *
+         ARCHIVE_ALIGNMENT;
+}
+
+int main() {
+  SetTraceLogLevel(LOG_WARNING);
+
+  std::vector<PackedFile> files;
+  FilePathList paths = LoadDirectoryFiles(ASSET_DIRECTORY);
+  for (unsigned int i = 0; i < paths.count; ++i) {
+    if (!IsPathFile(paths.paths[i])) {
+      continue;
+    }
+
+    // Same spelling the game uses when it asks for a file
+    std::string name =
+      std::string(ASSET_DIRECTORY) + "/" + GetFileName(paths.paths[i]);
+    if (name.size() >= (size_t)ARCHIVE_NAME_LENGTH) {
+      std::cerr << name << " is too long for the archive index." << std::endl;
+      return 1;
+    }
+
+    PackedFile file;
+    file.name = name;
+    file.data = LoadFileData(paths.paths[i], &file.size);
+    if (file.data == nullptr) {
+      std::cerr << "Unable to read " << name << std::endl;
+      return 1;
+    }
+    files.push_back(file);
+  }
+  UnloadDirectoryFiles(paths);
+
+  // The game binary searches the index
+  std::sort(
+    files.begin(), files.end(),
+    [](const PackedFile& a, const PackedFile& b) {
+      return strcmp(a.name.c_str(), b.name.c_str()) < 0;
+    }
+  );
+
+  ArchiveHeader header;
+  memcpy(header.magic, ARCHIVE_MAGIC, 4);
+  header.version = ARCHIVE_VERSION;
+  header.entryCount = files.size();
+  header.reserved = 0;
+
+  std::vector<ArchiveEntry> entries(files.size());
+  uint64_t offset = sizeof(ArchiveHeader) + files.size() * sizeof(ArchiveEntry);
+  for (size_t i = 0; i < files.size(); ++i) {
+    memset(entries[i].name, 0, ARCHIVE_NAME_LENGTH);
+    memcpy(entries[i].name, files[i].name.c_str(), files[i].name.size());
+    offset = AlignOffset(offset);
+    entries[i].offset = offset;
+    entries[i].size = files[i].size;
+    entries[i].hash = HashBytes(files[i].data, files[i].size);
+    offset += files[i].size;
+  }
+
+  std::ofstream archiveFile(
+    ASSET_ARCHIVE_FILENAME, std::ofstream::binary | std::ofstream::trunc
+  );
+  if (!archiveFile) {
+    std::cerr << "Unable to write " << ASSET_ARCHIVE_FILENAME << std::endl;
+    return 1;
+  }
+
+  archiveFile.write((const char*)&header, sizeof(ArchiveHeader));
+  archiveFile.write(
+    (const char*)entries.data(), entries.size() * sizeof(ArchiveEntry)
+  );
+
+  const char padding[ARCHIVE_ALIGNMENT] = {0};
+  uint64_t written =
+    sizeof(ArchiveHeader) + entries.size() * sizeof(ArchiveEntry);
+  for (size_t i = 0; i < files.size(); ++i) {
+    archiveFile.write(padding, entries[i].offset - written);
+    archiveFile.write((const char*)files[i].data, files[i].size);
+    written = entries[i].offset + files[i].size;
+    std::cout << files[i].name << ": " << files[i].size << " bytes"
+              << std::endl;
+    UnloadFileData(files[i].data);
+  }
+  archiveFile.close();
+
+  // Read it back the way the game will
+  AssetArchive archive;
+  if (!archive.Open(ASSET_ARCHIVE_FILENAME)) {
+    std::cerr << "Wrote an archive that doesn't open." << std::endl;
+    return 1;
+  }
+  for (uint32_t i = 0; i < archive.header->entryCount; ++i) {
+    if (!archive.Verify(&archive.entries[i])) {
+      std::cerr << archive.entries[i].name << " is corrupt." << std::endl;
+      return 1;
+    }
+  }
+  archive.Close();
+
+  std::cout << files.size() << " files packed into " << ASSET_ARCHIVE_FILENAME
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,224 @@
+#include <raylib.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "headers/sprites.hpp"
+
+// Packs every sprite in headers/sprites.hpp into as few atlas pages as it
+// can and writes the table the game reads them back with. Run it from the
+// project folder whenever an image in assets/ changes.
+
+const int ATLAS_PAGE_SIZE(2048);
+const int ATLAS_PADDING(2);  // empty pixels around each sprite
+const char* ATLAS_PAGE_FILENAME("./assets/atlas%d.png");
+
+struct Placement {
+  int sprite;
+  int page;
+  int x;
+  int y;
+};
+
+// Bottom-left skyline packer. The skyline is the top edge of everything
+// placed so far, stored as horizontal segments from left to right.
+struct SkylinePage {
+  struct Segment {
+    int x;
+    int y;
+    int width;
+  };
+
+  std::vector<Segment> skyline = {{0, 0, ATLAS_PAGE_SIZE}};
+  int usedWidth = 0;
+  int usedHeight = 0;
+
+  bool Place(int width, int height, int& outX, int& outY) {
+    int bestIndex = -1;
+    int bestY = ATLAS_PAGE_SIZE;
+    int bestWidth = ATLAS_PAGE_SIZE;
+
+    for (size_t i = 0; i < skyline.size(); ++i) {
+      int y;
+      if (!Fits(i, width, height, y)) {
+        continue;
+      }
+      if (y < bestY || (y == bestY && skyline[i].width < bestWidth)) {
+        bestIndex = i;
+        bestY = y;
+        bestWidth = skyline[i].width;
+      }
+    }
+
+    if (bestIndex < 0) {
+      return false;
+    }
+
+    outX = skyline[bestIndex].x;
+    outY = bestY;
+    AddSegment(bestIndex, outX, outY + height, width);
+    usedWidth = std::max(usedWidth, outX + width);
+    usedHeight = std::max(usedHeight, outY + height);
+    return true;
+  }
+
+ private:
+  // Height a rectangle would rest at if its left edge starts at segment i
+  bool Fits(size_t i, int width, int height, int& y) {
+    int x = skyline[i].x;
+    if (x + width > ATLAS_PAGE_SIZE) {
+      return false;
+    }
+
+    y = 0;
+    int widthLeft = width;
+    while (widthLeft > 0) {
+      if (i >= skyline.size()) {
+        return false;
+      }
+      y = std::max(y, skyline[i].y);
+      if (y + height > ATLAS_PAGE_SIZE) {
+        return false;
+      }
+      widthLeft -= skyline[i].width;
+      ++i;
+    }
+    return true;
+  }
+
+  void AddSegment(size_t index, int x, int y, int width) {
+    skyline.insert(skyline.begin() + index, {x, y, width});
+
+    // Trim or drop the segments the new one now covers
+    for (size_t i = index + 1; i < skyline.size(); ++i) {
+      Segment& previous = skyline[i - 1];
+      int overlap = previous.x + previous.width - skyline[i].x;
+      if (overlap <= 0) {
+        break;
+      }
+      skyline[i].x += overlap;
+      skyline[i].width -= overlap;
+      if (skyline[i].width > 0) {
+        break;
+      }
+      skyline.erase(skyline.begin() + i);
+      --i;
+    }
+
+    // Merge neighbours at the same height
+    for (size_t i = 1; i < skyline.size(); ++i) {
+      if (skyline[i - 1].y == skyline[i].y) {
+        skyline[i - 1].width += skyline[i].width;
+        skyline.erase(skyline.begin() + i);
+        --i;
+      }
+    }
+  }
+};
+
+int main() {
+  SetTraceLogLevel(LOG_WARNING);
+
+  std::vector<Image> images;
+  for (int i = 0; i < SPRITE_COUNT; ++i) {
+    Image image = LoadImage(SPRITE_FILES[i]);
+    if (image.data == nullptr) {
+      std::cerr << "Unable to load " << SPRITE_FILES[i] << std::endl;
+      return 1;
+    }
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    images.push_back(image);
+  }
+
+  // Tallest first packs tighter on a skyline
+  std::vector<int> order;
+  for (int i = 0; i < SPRITE_COUNT; ++i) {
+    order.push_back(i);
+  }
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+    if (images[a].height != images[b].height) {
+      return images[a].height > images[b].height;
+    }
+    return images[a].width > images[b].width;
+  });
+
+  std::vector<SkylinePage> pages;
+  std::vector<Placement> placements;
+  for (int sprite : order) {
+    int width = images[sprite].width + ATLAS_PADDING * 2;
+    int height = images[sprite].height + ATLAS_PADDING * 2;
+    if (width > ATLAS_PAGE_SIZE || height > ATLAS_PAGE_SIZE) {
+      std::cerr << SPRITE_FILES[sprite] << " is bigger than an atlas page."
+                << std::endl;
+      return 1;
+    }
+
+    Placement placement = {sprite, -1, 0, 0};
+    for (size_t p = 0; p < pages.size(); ++p) {
+      if (pages[p].Place(width, height, placement.x, placement.y)) {
+        placement.page = p;
+        break;
+      }
+    }
+    if (placement.page < 0) {
+      pages.push_back(SkylinePage());
+      pages.back().Place(width, height, placement.x, placement.y);
+      placement.page = pages.size() - 1;
+    }
+
+    placement.x += ATLAS_PADDING;
+    placement.y += ATLAS_PADDING;
+    placements.push_back(placement);
+  }
+
+  std::ofstream tableFile(ATLAS_TABLE_FILENAME, std::ofstream::trunc);
+  if (!tableFile) {
+    std::cerr << "Unable to write " << ATLAS_TABLE_FILENAME << std::endl;
+    return 1;
+  }
+  tableFile << pages.size() << std::endl;
+
+  for (size_t p = 0; p < pages.size(); ++p) {
+    Image page =
+      GenImageColor(pages[p].usedWidth, pages[p].usedHeight, BLANK);
+    for (const Placement& placement : placements) {
+      if (placement.page != (int)p) {
+        continue;
+      }
+      Image& image = images[placement.sprite];
+      ImageDraw(
+        &page, image, {0, 0, (float)image.width, (float)image.height},
+        {(float)placement.x, (float)placement.y, (float)image.width,
+         (float)image.height},
+        WHITE
+      );
+    }
+
+    const char* pageFilename = TextFormat(ATLAS_PAGE_FILENAME, (int)p);
+    if (!ExportImage(page, pageFilename)) {
+      std::cerr << "Unable to write " << pageFilename << std::endl;
+      return 1;
+    }
+    tableFile << pageFilename << std::endl;
+    std::cout << pageFilename << ": " << page.width << "x" << page.height
+              << std::endl;
+    UnloadImage(page);
+  }
+
+  for (const Placement& placement : placements) {
+    Image& image = images[placement.sprite];
+    tableFile << SPRITE_FILES[placement.sprite] << " " << placement.page << " "
+              << placement.x << " " << placement.y << " " << image.width << " "
+              << image.height << std::endl;
+  }
+  tableFile.close();
+
+  for (Image image : images) {
+    UnloadImage(image);
+  }
+
+  return 0;
+}
@@ -0,0 +1,58 @@
+#include <iostream>
+#include <vector>
+
+#include "headers/statehash.hpp"
+
+// Compares two state hash streams tick by tick, from the game or from
+// headless, and reports the first tick where they part and in which
+// subsystems:
+//   hashcompare statehash.bin statehash_headless.bin
+// Exits with 0 when they match, 1 when they don't.
+
+int main(int argc, char* argv[]) {
+  if (argc != 3) {
+    std::cerr << "Usage: hashcompare first.bin second.bin" << std::endl;
+    return 2;
+  }
+  std::vector<StateHash> first;
+  std::vector<StateHash> second;
+  if (!ReadStateHashes(argv[1], first) || !ReadStateHashes(argv[2], second)) {
+    return 2;
+  }
+
+  size_t count = first.size() < second.size() ? first.size() : second.size();
+  for (size_t i = 0; i < count; ++i) {
+    const StateHash& a = first[i];
+    const StateHash& b = second[i];
+    if (a.tick != b.tick) {
+      std::cout << "Entry " << i << " is tick " << a.tick << " in "
+                << argv[1] << " but tick " << b.tick << " in " << argv[2]
+                << ", the runs didn't start from the same tick" << std::endl;
+      return 1;
+    }
+
+    bool diverged = false;
+    for (int s = 0; s < STATE_SUBSYSTEMS; ++s) {
+      if (a.subsystems[s] != b.subsystems[s]) {
+        if (!diverged) {
+          std::cout << "First divergence at tick " << a.tick << ", after "
+                    << i << " matching ticks, in:" << std::endl;
+          diverged = true;
+        }
+        std::cout << "  " << STATE_SUBSYSTEM_NAMES[s] << std::endl;
+      }
+    }
+    if (diverged) {
+      return 1;
+    }
+  }
+
+  if (first.size() != second.size()) {
+    const char* longer = first.size() > second.size() ? argv[1] : argv[2];
+    std::cout << "The same for " << count << " ticks, then only " << longer
+              << " goes on" << std::endl;
+    return 1;
+  }
+  std::cout << "The same for all " << count << " ticks" << std::endl;
+  return 0;
+}
@@ -0,0 +1,193 @@
+#ifndef ALLOCATIONS
+#define ALLOCATIONS
+
+#include <raylib.h>
+
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+// Replaces the global operator new and delete to count every heap
+// allocation, whichever thread makes it. Include it from main.cpp only,
+// there can only be one definition in the program.
+std::atomic<long> allocationCount{0};
+std::atomic<long> allocationBytes{0};
+
+// Building with -DTRACK_ALLOCATIONS also attributes every allocation to
+// the innermost AllocationScope of the thread making it, and checks each
+// scope against its budget once per frame. Anything allocated outside a
+// scope, including on other threads, goes to scope 0.
+#ifdef TRACK_ALLOCATIONS
+const bool ALLOCATION_TRACKING(true);
+#else
+const bool ALLOCATION_TRACKING(false);
+#endif
+const int ALLOCATION_MAX_SCOPES(16);
+// Budgets aren't checked until containers have grown to their working size
+const int ALLOCATION_WARMUP_FRAMES(120);
+const int ALLOCATION_FONT_SIZE(10);
+
+// Only ever constant initialized, so allocations made before main starts
+// can already be counted
+struct AllocationScopeStats {
+  const char* name;
+  std::atomic<long> count;  // this frame so far
+  std::atomic<long> bytes;
+  long lastCount;  // the last finished frame
+  long lastBytes;
+  long worstCount;
+  long worstBytes;
+  long budgetCount;  // per frame, negative for none
+  long budgetBytes;
+};
+
+struct AllocationTracker {
+  AllocationScopeStats scopes[ALLOCATION_MAX_SCOPES];
+  int scopeCount;
+  long frames;
+  long framesOverBudget;
+
+  // Call before the scope is first entered. Budgets are per frame, pass
+  // -1 for no limit.
+  int AddScope(const char name[], long budgetCount, long budgetBytes) {
+    if (scopeCount == 0) {
+      SetUnscopedBudget(-1, -1);
+    }
+    assert(scopeCount < ALLOCATION_MAX_SCOPES);
+    AllocationScopeStats& scope = scopes[scopeCount];
+    scope.name = name;
+    scope.budgetCount = budgetCount;
+    scope.budgetBytes = budgetBytes;
+    return scopeCount++;
+  }
+
+  // Budget for what scope 0 catches, everything outside the others
+  void SetUnscopedBudget(long budgetCount, long budgetBytes) {
+    scopes[0].name = "other";
+    scopes[0].budgetCount = budgetCount;
+    scopes[0].budgetBytes = budgetBytes;
+    if (scopeCount == 0) {
+      scopeCount = 1;
+    }
+  }
+
+  // Once per frame. A scope over its budget is reported, and stops a
+  // debug build right there so the regression can't go unnoticed.
+  void EndFrame() {
+#ifdef TRACK_ALLOCATIONS
+    ++frames;
+    bool overBudget = false;
+    for (int i = 0; i < scopeCount; ++i) {
+      AllocationScopeStats& scope = scopes[i];
+      scope.lastCount = scope.count.exchange(0, std::memory_order_relaxed);
+      scope.lastBytes = scope.bytes.exchange(0, std::memory_order_relaxed);
+      if (scope.lastCount > scope.worstCount) {
+        scope.worstCount = scope.lastCount;
+      }
+      if (scope.lastBytes > scope.worstBytes) {
+        scope.worstBytes = scope.lastBytes;
+      }
+
+      if (frames <= ALLOCATION_WARMUP_FRAMES) {
+        continue;
+      }
+      if ((scope.budgetCount >= 0 && scope.lastCount > scope.budgetCount) ||
+          (scope.budgetBytes >= 0 && scope.lastBytes > scope.budgetBytes)) {
+        std::cerr << "Allocation budget exceeded in " << scope.name << ": "
+                  << scope.lastCount << " allocations, " << scope.lastBytes
+                  << " bytes in one frame (budget " << scope.budgetCount
+                  << ", " << scope.budgetBytes << ")" << std::endl;
+        overBudget = true;
+      }
+    }
+    if (overBudget) {
+      ++framesOverBudget;
+      assert(!"allocation budget exceeded, see above");
+    }
+#endif
+  }
+
+  void Draw(int x, int y) const {
+    char line[128];
+    DrawText(
+      "allocations  last frame / worst frame", x, y, ALLOCATION_FONT_SIZE,
+      ORANGE
+    );
+    for (int i = 0; i < scopeCount; ++i) {
+      const AllocationScopeStats& scope = scopes[i];
+      y += ALLOCATION_FONT_SIZE + 4;
+      snprintf(
+        line, sizeof(line), "%-8s %4ld (%6ld B) / %4ld (%6ld B)", scope.name,
+        scope.lastCount, scope.lastBytes, scope.worstCount, scope.worstBytes
+      );
+      DrawText(line, x, y, ALLOCATION_FONT_SIZE, ORANGE);
+    }
+  }
+
+  void Report() const {
+#ifdef TRACK_ALLOCATIONS
+    std::cerr << "Allocations, worst frame per scope over " << frames
+              << " frames, " << framesOverBudget << " over budget"
+              << std::endl;
+    for (int i = 0; i < scopeCount; ++i) {
+      std::cerr << "  " << scopes[i].name << ": " << scopes[i].worstCount
+                << " allocations, " << scopes[i].worstBytes << " bytes"
+                << std::endl;
+    }
+#endif
+  }
+};
+
+AllocationTracker allocationTracker;
+thread_local int currentAllocationScope = 0;
+
+// For long stretches of code that aren't a block, returns the scope that
+// was current
+int SwitchAllocationScope(int scope) {
+  int previous = currentAllocationScope;
+  currentAllocationScope = scope;
+  return previous;
+}
+
+// Allocations on this thread count towards scope until it goes out of
+// scope. Free when tracking is off.
+struct AllocationScope {
+#ifdef TRACK_ALLOCATIONS
+  int previous;
+
+  explicit AllocationScope(int scope) : previous(currentAllocationScope) {
+    currentAllocationScope = scope;
+  }
+  ~AllocationScope() { currentAllocationScope = previous; }
+#else
+  explicit AllocationScope(int) {}
+#endif
+  AllocationScope(const AllocationScope&) = delete;
+  AllocationScope& operator=(const AllocationScope&) = delete;
+};
+
+void* operator new(size_t size) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  allocationBytes.fetch_add(size, std::memory_order_relaxed);
+#ifdef TRACK_ALLOCATIONS
+  AllocationScopeStats& scope =
+    allocationTracker.scopes[currentAllocationScope];
+  scope.count.fetch_add(1, std::memory_order_relaxed);
+  scope.bytes.fetch_add(size, std::memory_order_relaxed);
+#endif
+  void* block = malloc(size > 0 ? size : 1);
+  if (block == nullptr) {
+    throw std::bad_alloc();
+  }
+  return block;
+}
+
+void operator delete(void* block) noexcept { free(block); }
+
+void operator delete(void* block, size_t) noexcept { free(block); }
+
+#endif
@@ -0,0 +1,234 @@
+#ifndef ARCHIVE
+#define ARCHIVE
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "hash.hpp"
+
+#if defined(_WIN32)
+// windows.h clashes with raylib (Rectangle, CloseWindow, DrawText...), so
+// only the few kernel32 calls needed for mapping a file are declared here
+extern "C" {
+__declspec(dllimport) void* __stdcall CreateFileA(
+  const char*, unsigned long, unsigned long, void*, unsigned long,
+  unsigned long, void*
+);
+__declspec(dllimport) int __stdcall GetFileSizeEx(void*, long long*);
+__declspec(dllimport) void* __stdcall CreateFileMappingA(
+  void*, void*, unsigned long, unsigned long, unsigned long, const char*
+);
+__declspec(dllimport) void* __stdcall MapViewOfFile(
+  void*, unsigned long, unsigned long, unsigned long, size_t
+);
+__declspec(dllimport) int __stdcall UnmapViewOfFile(const void*);
+__declspec(dllimport) int __stdcall CloseHandle(void*);
+}
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const char* ASSET_ARCHIVE_FILENAME("./assets.pak");
+
+// Layout: ArchiveHeader, then entryCount ArchiveEntry records sorted by
+// name, then the file contents. Every blob starts on an ARCHIVE_ALIGNMENT
+// boundary. All numbers are little-endian.
+const char ARCHIVE_MAGIC[4] = {'H', 'K', 'P', 'K'};
+const uint32_t ARCHIVE_VERSION(1);
+const uint64_t ARCHIVE_ALIGNMENT(16);
+const int ARCHIVE_NAME_LENGTH(64);
+
+struct ArchiveHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t entryCount;
+  uint32_t reserved;
+};
+
+struct ArchiveEntry {
+  char name[ARCHIVE_NAME_LENGTH];  // null terminated, e.g. ./assets/knight.png
+  uint64_t offset;                 // from the start of the archive
+  uint64_t size;
+  uint64_t hash;  // HashBytes of the contents
+};
+
+// Read-only view of a whole file mapped into memory
+struct MappedFile {
+  const unsigned char* data = nullptr;
+  size_t size = 0;
+
+#if defined(_WIN32)
+  void* fileHandle = nullptr;
+  void* mappingHandle = nullptr;
+#endif
+
+  bool Open(const char filename[]) {
+    Close();
+#if defined(_WIN32)
+    const unsigned long GENERIC_READ_ACCESS = 0x80000000;
+    const unsigned long SHARE_READ = 0x00000001;
+    const unsigned long OPEN_EXISTING_FILE = 3;
+    const unsigned long NORMAL_ATTRIBUTES = 0x80;
+    const unsigned long PAGE_READ_ONLY = 0x02;
+    const unsigned long MAP_READ = 0x0004;
+    void* const INVALID_HANDLE = (void*)(intptr_t)-1;
+
+    fileHandle = CreateFileA(
+      filename, GENERIC_READ_ACCESS, SHARE_READ, nullptr, OPEN_EXISTING_FILE,
+      NORMAL_ATTRIBUTES, nullptr
+    );
+    if (fileHandle == INVALID_HANDLE) {
+      fileHandle = nullptr;
+      return false;
+    }
+    long long fileSize = 0;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize <= 0) {
+      Close();
+      return false;
+    }
+    mappingHandle =
+      CreateFileMappingA(fileHandle, nullptr, PAGE_READ_ONLY, 0, 0, nullptr);
+    if (mappingHandle == nullptr) {
+      Close();
+      return false;
+    }
+    data = (const unsigned char*)MapViewOfFile(mappingHandle, MAP_READ, 0, 0, 0);
+    if (data == nullptr) {
+      Close();
+      return false;
+    }
+    size = (size_t)fileSize;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+      close(fd);
+      return false;
+    }
+    void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // The mapping keeps the file alive
+    if (mapped == MAP_FAILED) {
+      return false;
+    }
+    data = (const unsigned char*)mapped;
+    size = (size_t)info.st_size;
+#endif
+    return true;
+  }
+
+  void Close() {
+#if defined(_WIN32)
+    if (data != nullptr) {
+      UnmapViewOfFile(data);
+    }
+    if (mappingHandle != nullptr) {
+      CloseHandle(mappingHandle);
+    }
+    if (fileHandle != nullptr) {
+      CloseHandle(fileHandle);
+    }
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (data != nullptr) {
+      munmap((void*)data, size);
+    }
+#endif
+    data = nullptr;
+    size = 0;
+  }
+};
+
+// Looks files up inside a mapped asset archive. The spans it hands out
+// point straight into the mapping, so they stay valid until Close.
+struct AssetArchive {
+  MappedFile file;
+  const ArchiveHeader* header = nullptr;
+  const ArchiveEntry* entries = nullptr;
+
+  bool Open(const char filename[]) {
+    Close();
+    if (!file.Open(filename)) {
+      return false;
+    }
+
+    if (file.size < sizeof(ArchiveHeader)) {
+      Close();
+      return false;
+    }
+    header = (const ArchiveHeader*)file.data;
+    if (memcmp(header->magic, ARCHIVE_MAGIC, 4) != 0 ||
+        header->version != ARCHIVE_VERSION ||
+        file.size < sizeof(ArchiveHeader) +
+                      (uint64_t)header->entryCount * sizeof(ArchiveEntry)) {
+      Close();
+      return false;
+    }
+    entries = (const ArchiveEntry*)(file.data + sizeof(ArchiveHeader));
+
+    for (uint32_t i = 0; i < header->entryCount; ++i) {
+      if (entries[i].offset > file.size ||
+          entries[i].size > file.size - entries[i].offset ||
+          entries[i].name[ARCHIVE_NAME_LENGTH - 1] != '\0') {
+        Close();
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void Close() {
+    file.Close();
+    header = nullptr;
+    entries = nullptr;
+  }
+
+  bool IsOpen() const { return header != nullptr; }
+
+  const ArchiveEntry* Find(const std::string& name) const {
+    if (!IsOpen()) {
+      return nullptr;
+    }
+    // Entries are sorted by name
+    uint32_t low = 0;
+    uint32_t high = header->entryCount;
+    while (low < high) {
+      uint32_t middle = low + (high - low) / 2;
+      int order = strcmp(entries[middle].name, name.c_str());
+      if (order == 0) {
+        return &entries[middle];
+      } else if (order < 0) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    return nullptr;
+  }
+
+  bool Read(
+    const std::string& name, const unsigned char*& outData,
+    unsigned int& outSize
+  ) const {
+    const ArchiveEntry* entry = Find(name);
+    if (entry == nullptr) {
+      return false;
+    }
+    outData = file.data + entry->offset;
+    outSize = (unsigned int)entry->size;
+    return true;
+  }
+
+  bool Verify(const ArchiveEntry* entry) const {
+    return HashBytes(file.data + entry->offset, entry->size) == entry->hash;
+  }
+};
+
+#endif
@@ -0,0 +1,217 @@
+#ifndef ASSET_CACHE
+#define ASSET_CACHE
+
+#include <raylib.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+#include "archive.hpp"
+#include "hash.hpp"
+
+const char* ASSET_CACHE_DIRECTORY("./cache");
+const char ASSET_CACHE_MAGIC[4] = {'H', 'K', 'D', 'C'};
+// Bump when the header changes or raylib starts decoding differently, old
+// entries are then ignored
+const uint32_t ASSET_CACHE_VERSION(1);
+
+enum CacheEntryKind { CACHED_IMAGE = 1, CACHED_WAVE = 2 };
+
+// Sits in front of the raw pixels or samples. 64 bytes, so the data that
+// follows stays aligned when the file is mapped.
+struct CacheHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t kind;
+  uint32_t reserved;
+  uint64_t sourceHash;
+  uint64_t dataSize;
+
+  int32_t width;
+  int32_t height;
+  int32_t mipmaps;
+  int32_t format;
+
+  uint32_t frameCount;
+  uint32_t sampleRate;
+  uint32_t sampleSize;
+  uint32_t channels;
+};
+
+// Already decoded images and waves on disk, named after the source file and
+// the hash of its contents. A source that changes hashes differently and
+// simply misses, so stale entries are never read. Hits are mapped instead
+// of read, and the Image/Wave data points straight into the mapping.
+struct AssetCache {
+  std::string directory = ASSET_CACHE_DIRECTORY;
+
+  bool ReadImage(
+    const std::string& sourcePath, uint64_t sourceHash, MappedFile& mapping,
+    Image& out
+  ) {
+    const CacheHeader* header =
+      Open(sourcePath, sourceHash, CACHED_IMAGE, mapping);
+    if (header == nullptr) {
+      return false;
+    }
+    out.data = (void*)(mapping.data + sizeof(CacheHeader));
+    out.width = header->width;
+    out.height = header->height;
+    out.mipmaps = header->mipmaps;
+    out.format = header->format;
+    return true;
+  }
+
+  bool ReadWave(
+    const std::string& sourcePath, uint64_t sourceHash, MappedFile& mapping,
+    Wave& out
+  ) {
+    const CacheHeader* header =
+      Open(sourcePath, sourceHash, CACHED_WAVE, mapping);
+    if (header == nullptr) {
+      return false;
+    }
+    out.data = (void*)(mapping.data + sizeof(CacheHeader));
+    out.frameCount = header->frameCount;
+    out.sampleRate = header->sampleRate;
+    out.sampleSize = header->sampleSize;
+    out.channels = header->channels;
+    return true;
+  }
+
+  void WriteImage(
+    const std::string& sourcePath, uint64_t sourceHash, const Image& image
+  ) {
+    CacheHeader header = MakeHeader(CACHED_IMAGE, sourceHash);
+    header.width = image.width;
+    header.height = image.height;
+    header.mipmaps = image.mipmaps;
+    header.format = image.format;
+    header.dataSize = GetImageDataSize(image);
+    Write(sourcePath, header, image.data);
+  }
+
+  void WriteWave(
+    const std::string& sourcePath, uint64_t sourceHash, const Wave& wave
+  ) {
+    CacheHeader header = MakeHeader(CACHED_WAVE, sourceHash);
+    header.frameCount = wave.frameCount;
+    header.sampleRate = wave.sampleRate;
+    header.sampleSize = wave.sampleSize;
+    header.channels = wave.channels;
+    header.dataSize =
+      (uint64_t)wave.frameCount * wave.channels * (wave.sampleSize / 8);
+    Write(sourcePath, header, wave.data);
+  }
+
+ private:
+  // Every cached version of a source shares this prefix, which is how old
+  // ones are found and deleted. snprintf rather than TextFormat since this
+  // runs on the asset workers.
+  std::string EntryPrefix(const std::string& sourcePath) {
+    char prefix[32];
+    snprintf(
+      prefix, sizeof(prefix), "%016llx-",
+      (unsigned long long)HashBytes(sourcePath.data(), sourcePath.size())
+    );
+    return prefix;
+  }
+
+  std::string EntryPath(const std::string& sourcePath, uint64_t sourceHash) {
+    char name[32];
+    snprintf(
+      name, sizeof(name), "%016llx.bin", (unsigned long long)sourceHash
+    );
+    return directory + "/" + EntryPrefix(sourcePath) + name;
+  }
+
+  CacheHeader MakeHeader(CacheEntryKind kind, uint64_t sourceHash) {
+    CacheHeader header;
+    memset(&header, 0, sizeof(CacheHeader));
+    memcpy(header.magic, ASSET_CACHE_MAGIC, 4);
+    header.version = ASSET_CACHE_VERSION;
+    header.kind = kind;
+    header.sourceHash = sourceHash;
+    return header;
+  }
+
+  uint64_t GetImageDataSize(const Image& image) {
+    uint64_t size = 0;
+    int width = image.width;
+    int height = image.height;
+    for (int i = 0; i < image.mipmaps; ++i) {
+      size += GetPixelDataSize(width, height, image.format);
+      width = width > 1 ? width / 2 : 1;
+      height = height > 1 ? height / 2 : 1;
+    }
+    return size;
+  }
+
+  const CacheHeader* Open(
+    const std::string& sourcePath, uint64_t sourceHash, CacheEntryKind kind,
+    MappedFile& mapping
+  ) {
+    std::string entryPath = EntryPath(sourcePath, sourceHash);
+    if (!mapping.Open(entryPath.c_str())) {
+      return nullptr;
+    }
+
+    const CacheHeader* header = (const CacheHeader*)mapping.data;
+    if (mapping.size < sizeof(CacheHeader) ||
+        memcmp(header->magic, ASSET_CACHE_MAGIC, 4) != 0 ||
+        header->version != ASSET_CACHE_VERSION || header->kind != kind ||
+        header->sourceHash != sourceHash ||
+        header->dataSize != mapping.size - sizeof(CacheHeader)) {
+      mapping.Close();
+      return nullptr;
+    }
+    return header;
+  }
+
+  // Written to a temporary name and renamed into place, so a crash halfway
+  // never leaves a truncated entry behind. Called from the asset workers,
+  // every entry has its own file so they don't step on each other.
+  void Write(
+    const std::string& sourcePath, CacheHeader& header, const void* data
+  ) {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+      return;
+    }
+
+    // Drop the entries of older versions of this source
+    std::string prefix = EntryPrefix(sourcePath);
+    for (const auto& file :
+         std::filesystem::directory_iterator(directory, error)) {
+      std::string name = file.path().filename().string();
+      if (name.compare(0, prefix.size(), prefix) == 0) {
+        std::filesystem::remove(file.path(), error);
+      }
+    }
+
+    std::string entryPath = EntryPath(sourcePath, header.sourceHash);
+    std::string temporaryPath = entryPath + ".tmp";
+    std::ofstream entryFile(
+      temporaryPath, std::ofstream::binary | std::ofstream::trunc
+    );
+    if (!entryFile) {
+      return;
+    }
+    entryFile.write((const char*)&header, sizeof(CacheHeader));
+    entryFile.write((const char*)data, header.dataSize);
+    entryFile.close();
+    if (!entryFile) {
+      std::filesystem::remove(temporaryPath, error);
+      return;
+    }
+    std::filesystem::rename(temporaryPath, entryPath, error);
+  }
+};
+
+#endif
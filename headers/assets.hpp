@@ -0,0 +1,537 @@
+#ifndef ASSETS
+#define ASSETS
+
+#include <raylib.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "archive.hpp"
+#include "assetcache.hpp"
+#include "hash.hpp"
+
+// How often the watcher looks at the files behind loaded assets
+const int ASSET_WATCH_INTERVAL_MS(500);
+
+enum AssetType { TEXTURE_ASSET, SOUND_ASSET, MUSIC_ASSET };
+enum AssetState { ASSET_DECODING, ASSET_READY, ASSET_FAILED };
+
+// One loaded file. Pointers to an Asset stay valid until its last reference
+// is released, so holders can keep reading texture/sound/music from it.
+struct Asset {
+  std::string path;
+  AssetType type;
+  AssetState state = ASSET_DECODING;
+  int refCount = 0;
+  bool reloading = false;  // a new version is being decoded
+  bool fromDisk = false;   // never read from the archive
+
+  // Filled in by a worker thread
+  Image image = {0};
+  Wave wave = {0};
+  unsigned char* fileData = nullptr;  // music streams straight from this
+  unsigned int fileSize = 0;
+  bool ownsFileData = false;  // false when it points into the archive
+  MappedFile cacheMapping;     // image/wave data points in here on a hit
+
+  // Filled in on the main thread once decoding is done
+  Texture texture = {0};
+  Sound sound = {0};
+  Music music = {0};
+};
+
+// Loads textures, sounds and music by path. Each path is only loaded once
+// and shared between everyone that acquires it. Decoding happens on worker
+// threads, and only the GPU/audio upload runs on the main thread in
+// Update, since raylib needs that on the thread that owns the window.
+//
+// Files found in the archive are decoded straight out of its mapping, and
+// anything missing from it is read from disk. With a cache set, images and
+// waves that were decoded on an earlier run are mapped from it instead of
+// being decoded again.
+//
+// Once StartWatching is called, textures and sounds whose files change on
+// disk are decoded again in the background and swapped in by Update. The
+// new version is read from the loose file even if the archive has one.
+// Files nothing has acquired can be watched too, their changes are passed
+// to fileChanged.
+struct AssetManager {
+  const AssetArchive* archive = nullptr;
+  AssetCache* cache = nullptr;
+  // Runs in Update right before a reload replaces a texture or sound, while
+  // the old one is still loaded. For anything built on top of the old one,
+  // like sound aliases.
+  std::function<void(Asset*)> beforeReload;
+  // Runs in Update when a file added with Watch changes
+  std::function<void(const std::string&)> fileChanged;
+  std::unordered_map<std::string, Asset*> assets;
+  int pendingCount = 0;  // acquired but not uploaded yet
+
+  std::vector<std::thread> workers;
+  std::mutex queueMutex;
+  std::condition_variable queueReady;
+  std::deque<Asset*> decodeQueue;
+  bool stopping = false;
+
+  std::mutex decodedMutex;
+  std::condition_variable decodedReady;
+  std::vector<Asset*> decoded;
+  std::vector<Asset*> uploading;  // main thread only, reused every Update
+
+  std::thread watcher;
+  std::mutex watchMutex;
+  std::condition_variable watchWake;
+  std::unordered_set<std::string> watched;
+  std::vector<std::string> changed;
+  std::vector<std::string> reloadPaths;  // main thread only, like uploading
+  bool watchStopping = false;
+
+  void Start(int workerCount = std::thread::hardware_concurrency()) {
+    if (workerCount < 1) {
+      workerCount = 1;
+    }
+    stopping = false;
+    for (int i = 0; i < workerCount; ++i) {
+      workers.push_back(std::thread(&AssetManager::WorkerLoop, this));
+    }
+  }
+
+  // Polls modification times on its own thread, so a slow disk never holds
+  // up a frame
+  void StartWatching() {
+    watchStopping = false;
+    watcher = std::thread(&AssetManager::WatchLoop, this);
+  }
+
+  // For files that aren't loaded as they are, like the sources of packed
+  // sprites
+  void Watch(const std::string& path) {
+    std::lock_guard<std::mutex> lock(watchMutex);
+    watched.insert(path);
+  }
+
+  void Unwatch(const std::string& path) {
+    std::lock_guard<std::mutex> lock(watchMutex);
+    watched.erase(path);
+  }
+
+  // Starts loading the file if nobody holds it yet. Safe to call before the
+  // window exists, the upload waits for Update. fromDisk skips the archive,
+  // for a file edited since it was packed.
+  Asset* Acquire(
+    const std::string& path, AssetType type, bool fromDisk = false
+  ) {
+    auto found = assets.find(path);
+    if (found != assets.end()) {
+      ++found->second->refCount;
+      return found->second;
+    }
+
+    Asset* asset = new Asset;
+    asset->path = path;
+    asset->type = type;
+    asset->refCount = 1;
+    asset->fromDisk = fromDisk;
+    assets[path] = asset;
+    ++pendingCount;
+
+    if (type != MUSIC_ASSET) {  // music is streaming, can't swap it
+      std::lock_guard<std::mutex> lock(watchMutex);
+      watched.insert(path);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(queueMutex);
+      decodeQueue.push_back(asset);
+    }
+    queueReady.notify_one();
+    return asset;
+  }
+
+  // Unloads the asset once nobody holds it anymore
+  void Release(Asset* asset) {
+    if (--asset->refCount > 0 || asset->state == ASSET_DECODING ||
+        asset->reloading) {
+      return;  // Still loading ones are cleaned up when they arrive
+    }
+    assets.erase(asset->path);
+    Unload(asset);
+  }
+
+  // Whole contents of a text file such as a table or config
+  bool ReadText(const std::string& path, std::string& out) {
+    const unsigned char* data;
+    unsigned int size;
+    if (archive != nullptr && archive->Read(path, data, size)) {
+      out.assign((const char*)data, size);
+      return true;
+    }
+
+    std::ifstream file(path);
+    if (!file) {
+      return false;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    out = contents.str();
+    return true;
+  }
+
+  // Uploads whatever the workers finished since the last call and queues
+  // changed files for reloading. Main thread only, call it once per frame
+  // outside of drawing so a swap never happens halfway through one.
+  void Update() {
+    {
+      std::lock_guard<std::mutex> lock(watchMutex);
+      reloadPaths.swap(changed);
+    }
+    for (const std::string& path : reloadPaths) {
+      auto found = assets.find(path);
+      if (found == assets.end()) {
+        if (fileChanged) {
+          fileChanged(path);
+        }
+        continue;
+      }
+      if (found->second->state != ASSET_READY ||
+          found->second->reloading) {
+        continue;
+      }
+      found->second->reloading = true;
+      {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        decodeQueue.push_back(found->second);
+      }
+      queueReady.notify_one();
+    }
+    reloadPaths.clear();
+
+    {
+      std::lock_guard<std::mutex> lock(decodedMutex);
+      uploading.swap(decoded);
+    }
+
+    for (Asset* asset : uploading) {
+      if (asset->reloading) {
+        Reload(asset);
+      } else {
+        --pendingCount;
+        Upload(asset);
+      }
+      if (asset->refCount <= 0) {
+        assets.erase(asset->path);
+        Unload(asset);
+      }
+    }
+    uploading.clear();
+  }
+
+  // Blocks until everything acquired so far is ready to use
+  void WaitAll() {
+    while (pendingCount > 0) {
+      {
+        std::unique_lock<std::mutex> lock(decodedMutex);
+        decodedReady.wait(lock, [this] { return !decoded.empty(); });
+      }
+      Update();
+    }
+  }
+
+  // Stops the workers and unloads everything still held. Has to run before
+  // CloseWindow and CloseAudioDevice.
+  void Shutdown() {
+    if (watcher.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(watchMutex);
+        watchStopping = true;
+      }
+      watchWake.notify_all();
+      watcher.join();
+    }
+    changed.clear();
+
+    {
+      std::lock_guard<std::mutex> lock(queueMutex);
+      stopping = true;
+    }
+    queueReady.notify_all();
+    for (std::thread& worker : workers) {
+      worker.join();
+    }
+    workers.clear();
+
+    Update();
+    for (auto& entry : assets) {
+      Unload(entry.second);
+    }
+    assets.clear();
+  }
+
+ private:
+  void WorkerLoop() {
+    while (true) {
+      Asset* asset;
+      {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        queueReady.wait(lock, [this] {
+          return stopping || !decodeQueue.empty();
+        });
+        if (decodeQueue.empty()) {
+          return;
+        }
+        asset = decodeQueue.front();
+        decodeQueue.pop_front();
+      }
+
+      Decode(asset);
+
+      {
+        std::lock_guard<std::mutex> lock(decodedMutex);
+        decoded.push_back(asset);
+      }
+      decodedReady.notify_all();
+    }
+  }
+
+  // Worker thread, CPU work only
+  void Decode(Asset* asset) {
+    const char* path = asset->path.c_str();
+    const unsigned char* data = nullptr;
+    unsigned int size = 0;
+    uint64_t hash = 0;
+    unsigned char* loaded = nullptr;  // freed here unless music keeps it
+
+    const ArchiveEntry* entry = nullptr;
+    if (archive != nullptr && !asset->reloading && !asset->fromDisk) {
+      entry = archive->Find(asset->path);
+    }
+    if (entry != nullptr) {
+      data = archive->file.data + entry->offset;
+      size = entry->size;
+      hash = entry->hash;  // Already worked out by the packer
+    } else {
+      loaded = LoadFileData(path, &size);
+      data = loaded;
+      if (data != nullptr && cache != nullptr) {
+        hash = HashBytes(data, size);
+      }
+    }
+    if (data == nullptr) {
+      return;
+    }
+
+    const char* fileType = GetFileExtension(path);
+    switch (asset->type) {
+      case TEXTURE_ASSET:
+        if (cache != nullptr && cache->ReadImage(
+                                  asset->path, hash, asset->cacheMapping,
+                                  asset->image
+                                )) {
+          break;
+        }
+        asset->image = LoadImageFromMemory(fileType, data, size);
+        if (cache != nullptr && asset->image.data != nullptr) {
+          cache->WriteImage(asset->path, hash, asset->image);
+        }
+        break;
+      case SOUND_ASSET:
+        if (cache != nullptr && cache->ReadWave(
+                                  asset->path, hash, asset->cacheMapping,
+                                  asset->wave
+                                )) {
+          break;
+        }
+        asset->wave = LoadWaveFromMemory(fileType, data, size);
+        if (cache != nullptr && asset->wave.data != nullptr) {
+          cache->WriteWave(asset->path, hash, asset->wave);
+        }
+        break;
+      case MUSIC_ASSET:
+        // Streamed while it plays, so the bytes have to stay around. Ones
+        // from the archive aren't copied, it stays mapped the whole run.
+        asset->fileData = (unsigned char*)data;
+        asset->fileSize = size;
+        asset->ownsFileData = loaded != nullptr;
+        loaded = nullptr;
+        break;
+    }
+
+    if (loaded != nullptr) {
+      UnloadFileData(loaded);
+    }
+  }
+
+  // Frees decoded data that was only needed for the upload. Cache hits
+  // point into the mapping rather than raylib's allocator.
+  void ReleaseDecoded(Asset* asset) {
+    if (asset->cacheMapping.data != nullptr) {
+      asset->cacheMapping.Close();
+    } else {
+      if (asset->image.data != nullptr) {
+        UnloadImage(asset->image);
+      }
+      if (asset->wave.data != nullptr) {
+        UnloadWave(asset->wave);
+      }
+    }
+    asset->image = {0};
+    asset->wave = {0};
+  }
+
+  // Main thread
+  void Upload(Asset* asset) {
+    asset->state = ASSET_READY;
+    switch (asset->type) {
+      case TEXTURE_ASSET:
+        if (asset->image.data == nullptr) {
+          asset->state = ASSET_FAILED;
+          break;
+        }
+        asset->texture = LoadTextureFromImage(asset->image);
+        ReleaseDecoded(asset);
+        break;
+      case SOUND_ASSET:
+        if (asset->wave.data == nullptr) {
+          asset->state = ASSET_FAILED;
+          break;
+        }
+        asset->sound = LoadSoundFromWave(asset->wave);
+        ReleaseDecoded(asset);
+        break;
+      case MUSIC_ASSET:
+        if (asset->fileData == nullptr) {
+          asset->state = ASSET_FAILED;
+          break;
+        }
+        asset->music = LoadMusicStreamFromMemory(
+          GetFileExtension(asset->path.c_str()), asset->fileData,
+          asset->fileSize
+        );
+        break;
+    }
+
+    if (asset->state == ASSET_FAILED) {
+      std::cerr << "Unable to load " << asset->path << std::endl;
+    }
+  }
+
+  // Swaps in the texture or sound decoded by a reload. Everyone reads them
+  // through the Asset, so they all see the new one from this frame on. A
+  // file that fails to decode, like one still being saved, keeps the old
+  // version.
+  void Reload(Asset* asset) {
+    asset->reloading = false;
+    switch (asset->type) {
+      case TEXTURE_ASSET:
+        if (asset->image.data == nullptr) {
+          break;
+        }
+        if (beforeReload) {
+          beforeReload(asset);
+        }
+        UnloadTexture(asset->texture);
+        asset->texture = LoadTextureFromImage(asset->image);
+        ReleaseDecoded(asset);
+        std::cerr << "Reloaded " << asset->path << std::endl;
+        return;
+      case SOUND_ASSET:
+        if (asset->wave.data == nullptr) {
+          break;
+        }
+        if (beforeReload) {
+          beforeReload(asset);
+        }
+        UnloadSound(asset->sound);
+        asset->sound = LoadSoundFromWave(asset->wave);
+        ReleaseDecoded(asset);
+        std::cerr << "Reloaded " << asset->path << std::endl;
+        return;
+      case MUSIC_ASSET:
+        break;
+    }
+    std::cerr << "Unable to reload " << asset->path << std::endl;
+  }
+
+  // Watcher thread. A new modification time is only reported once it has
+  // stayed the same for a whole interval, so a file is not picked up while
+  // an editor is still writing it.
+  void WatchLoop() {
+    struct WatchedFile {
+      std::filesystem::file_time_type reported;
+      std::filesystem::file_time_type seen;
+    };
+    std::unordered_map<std::string, WatchedFile> files;
+    std::vector<std::string> paths;
+
+    std::unique_lock<std::mutex> lock(watchMutex);
+    while (!watchStopping) {
+      paths.assign(watched.begin(), watched.end());
+      lock.unlock();
+
+      std::vector<std::string> found;
+      for (const std::string& path : paths) {
+        std::error_code error;
+        auto time = std::filesystem::last_write_time(path, error);
+        if (error) {
+          continue;  // Only in the archive, or deleted for now
+        }
+        auto known = files.find(path);
+        if (known == files.end()) {
+          files[path] = {time, time};
+        } else if (time != known->second.reported) {
+          if (time == known->second.seen) {
+            known->second.reported = time;
+            found.push_back(path);
+          }
+          known->second.seen = time;
+        }
+      }
+
+      lock.lock();
+      changed.insert(changed.end(), found.begin(), found.end());
+      watchWake.wait_for(
+        lock, std::chrono::milliseconds(ASSET_WATCH_INTERVAL_MS),
+        [this] { return watchStopping; }
+      );
+    }
+  }
+
+  void Unload(Asset* asset) {
+    {
+      std::lock_guard<std::mutex> lock(watchMutex);
+      watched.erase(asset->path);
+    }
+    if (asset->state == ASSET_READY) {
+      switch (asset->type) {
+        case TEXTURE_ASSET:
+          UnloadTexture(asset->texture);
+          break;
+        case SOUND_ASSET:
+          UnloadSound(asset->sound);
+          break;
+        case MUSIC_ASSET:
+          UnloadMusicStream(asset->music);
+          break;
+      }
+    }
+    ReleaseDecoded(asset);
+    if (asset->fileData != nullptr && asset->ownsFileData) {
+      UnloadFileData(asset->fileData);
+    }
+    delete asset;
+  }
+};
+
+#endif
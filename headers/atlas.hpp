@@ -0,0 +1,156 @@
+#ifndef ATLAS
+#define ATLAS
+
+#include <raylib.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "assets.hpp"
+#include "sprites.hpp"
+
+// Where a sprite lives: the texture holding it and its rectangle inside
+struct SpriteRegion {
+  Texture texture;
+  Rectangle source;
+
+  // A part of the sprite, given in the coordinates of the original image.
+  // Negative sizes flip like they do in DrawTextureRec.
+  Rectangle Crop(Rectangle local) const {
+    return {source.x + local.x, source.y + local.y, local.width, local.height};
+  }
+
+  Vector2 Size() const { return {source.width, source.height}; }
+};
+
+// Resolves sprite ids to regions of the atlas pages made by atlaspacker.
+// If the atlas hasn't been built, every sprite is loaded from its own file
+// instead and sits alone on its own page.
+//
+// With a watching AssetManager the sprites' own files are watched even
+// when packed. A sprite whose file changes is drawn from that file on a
+// page of its own from then on, until the atlas is loaded again.
+//
+// Pages are loaded through the AssetManager, so Get is only usable once the
+// manager has uploaded them.
+struct SpriteAtlas {
+  AssetManager* assets = nullptr;
+  std::vector<Asset*> pages;
+  int spritePages[SPRITE_COUNT];
+  Rectangle spriteSources[SPRITE_COUNT];
+  int loosePages[SPRITE_COUNT];  // edited since packing, -1 for none
+  bool isPacked = false;
+
+  void Load(const char tableFilename[], AssetManager* assetManager) {
+    Unload();
+    assets = assetManager;
+    std::string table;
+    if (assets->ReadText(tableFilename, table) && LoadTable(table)) {
+      isPacked = true;
+      for (int i = 0; i < SPRITE_COUNT; ++i) {
+        assets->Watch(SPRITE_FILES[i]);
+      }
+      assets->fileChanged = [this](const std::string& path) {
+        SpriteChanged(path);
+      };
+      return;
+    }
+
+    std::cerr << "No sprite atlas, loading sprites one by one." << std::endl;
+    for (int i = 0; i < SPRITE_COUNT; ++i) {
+      pages.push_back(assets->Acquire(SPRITE_FILES[i], TEXTURE_ASSET));
+      spritePages[i] = i;
+      spriteSources[i] = {0, 0, -1, -1};  // whole texture, see Get
+    }
+  }
+
+  void Unload() {
+    for (Asset* page : pages) {
+      assets->Release(page);
+    }
+    if (isPacked) {
+      for (int i = 0; i < SPRITE_COUNT; ++i) {
+        assets->Unwatch(SPRITE_FILES[i]);
+      }
+      assets->fileChanged = nullptr;
+    }
+    pages.clear();
+    for (int i = 0; i < SPRITE_COUNT; ++i) {
+      loosePages[i] = -1;
+    }
+    isPacked = false;
+  }
+
+  SpriteRegion Get(SpriteId id) const {
+    int page = spritePages[id];
+    Rectangle source = spriteSources[id];
+    // The atlas until the edited file is uploaded, or if it doesn't load
+    if (loosePages[id] >= 0 && pages[loosePages[id]]->state == ASSET_READY) {
+      page = loosePages[id];
+      source = {0, 0, -1, -1};
+    }
+    const Texture& texture = pages[page]->texture;
+    if (source.width < 0) {
+      source = {0, 0, (float)texture.width, (float)texture.height};
+    }
+    return {texture, source};
+  }
+
+ private:
+  // Further edits reload the loose page like any other texture
+  void SpriteChanged(const std::string& path) {
+    for (int i = 0; i < SPRITE_COUNT; ++i) {
+      if (path == SPRITE_FILES[i] && loosePages[i] < 0) {
+        pages.push_back(assets->Acquire(path, TEXTURE_ASSET, true));
+        loosePages[i] = pages.size() - 1;
+        std::cerr << path << " changed, drawing it from its own file."
+                  << std::endl;
+      }
+    }
+  }
+
+  // Table layout: page count, one page file per line, then one line per
+  // sprite with its source file, page and rectangle
+  bool LoadTable(const std::string& table) {
+    std::istringstream tableFile(table);
+    int pageCount;
+    tableFile >> pageCount;
+    for (int i = 0; i < pageCount; ++i) {
+      std::string pageFilename;
+      tableFile >> pageFilename;
+      pages.push_back(assets->Acquire(pageFilename, TEXTURE_ASSET));
+    }
+
+    bool found[SPRITE_COUNT] = {false};
+    std::string spriteFilename;
+    int page;
+    Rectangle source;
+    while (tableFile >> spriteFilename >> page >> source.x >> source.y >>
+           source.width >> source.height) {
+      if (page < 0 || page >= pageCount) {
+        continue;
+      }
+      for (int i = 0; i < SPRITE_COUNT; ++i) {
+        if (spriteFilename == SPRITE_FILES[i]) {
+          spritePages[i] = page;
+          spriteSources[i] = source;
+          found[i] = true;
+        }
+      }
+    }
+
+    for (int i = 0; i < SPRITE_COUNT; ++i) {
+      if (!found[i]) {
+        std::cerr << "Sprite atlas is missing " << SPRITE_FILES[i]
+                  << ", run atlaspacker again." << std::endl;
+        Unload();
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+#endif
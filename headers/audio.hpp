@@ -0,0 +1,322 @@
+#ifndef AUDIO
+#define AUDIO
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "assets.hpp"
+
+// Must be a power of two
+const unsigned int AUDIO_EVENT_CAPACITY(256);
+const int AUDIO_UPDATE_INTERVAL_MS(5);
+// Frames in each half of a music stream's buffer. About 185ms at 44.1kHz,
+// so the stream survives the audio thread being held up for a while.
+const unsigned int AUDIO_STREAM_BUFFER_FRAMES(8192);
+
+// Sounds playing at once across every voice pool. Below what the pools hold
+// together, 2 swings and 4 splatters, so a burst of kills takes voices from
+// the swings rather than stacking on top of them.
+const int AUDIO_MAX_VOICES(5);
+// Positional sounds fade out linearly up to this distance from the listener
+const float AUDIO_FALLOFF_DISTANCE(1200);
+// Anything quieter than this isn't worth a voice
+const float AUDIO_MIN_VOLUME(0.05f);
+// An equally loud voice younger than this isn't cut off for a new one, so a
+// burst of identical hits doesn't keep restarting the same voices
+const int AUDIO_STEAL_MIN_AGE_MS(80);
+
+enum AudioEventType { PLAY_SOUND_EVENT, PLAY_MUSIC_EVENT, STOP_MUSIC_EVENT };
+
+struct AudioEvent {
+  AudioEventType type;
+  Asset* asset;
+  float volume;
+};
+
+// One playing copy of a sound. Aliases share the sample data of the sound
+// they were made from, so several can play at once for little memory.
+struct Voice {
+  Sound alias;
+  float volume;
+  std::chrono::steady_clock::time_point startedAt;
+};
+
+struct VoicePool {
+  Asset* asset;
+  int maxVoices;
+  std::vector<Voice> voices;  // made on the first play, see AudioThread
+};
+
+// Fixed size ring of events with one producer, the game thread, and one
+// consumer, the audio thread. Neither side ever waits on the other.
+struct AudioEventQueue {
+  AudioEvent events[AUDIO_EVENT_CAPACITY];
+  std::atomic<unsigned int> head{0};  // next to read, audio thread only
+  std::atomic<unsigned int> tail{0};  // next to write, game thread only
+
+  // False when full, the event is dropped rather than blocking the game
+  bool Push(const AudioEvent& event) {
+    unsigned int writeIndex = tail.load(std::memory_order_relaxed);
+    if (writeIndex - head.load(std::memory_order_acquire) >=
+        AUDIO_EVENT_CAPACITY) {
+      return false;
+    }
+    events[writeIndex & (AUDIO_EVENT_CAPACITY - 1)] = event;
+    tail.store(writeIndex + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool Pop(AudioEvent& event) {
+    unsigned int readIndex = head.load(std::memory_order_relaxed);
+    if (readIndex == tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    event = events[readIndex & (AUDIO_EVENT_CAPACITY - 1)];
+    head.store(readIndex + 1, std::memory_order_release);
+    return true;
+  }
+};
+
+// Plays sounds and keeps music streaming on its own thread, so a long
+// frame on the game side can't starve the music buffer. The game only
+// posts events, all raylib audio calls for them happen here.
+//
+// Sounds are read from their Asset when played, and hot reload swaps them
+// on the game thread, so hold assetMutex around AssetManager::Update.
+//
+// Sounds given a voice pool play on aliases instead, so hits overlap rather
+// than restarting each other. When a pool or the AUDIO_MAX_VOICES total is
+// full, the quietest and then oldest voice is cut for a louder sound, and
+// sounds that would be the quietest are dropped, which keeps the mixer's
+// work bounded however many hits land at once.
+struct AudioThread {
+  AudioEventQueue queue;
+  std::mutex assetMutex;
+  std::atomic<bool> running{false};
+  std::atomic<int> droppedEvents{0};
+  std::atomic<int> culledSounds{0};  // not played, no voice worth stealing
+  std::thread thread;
+
+  Asset* music = nullptr;             // audio thread only
+  std::vector<VoicePool> voicePools;  // set up before Start
+
+  // Call before Start
+  void AddVoices(Asset* sound, int maxVoices) {
+    assert(maxVoices > 0);  // a pool always has a voice to play or steal
+    voicePools.push_back({sound, maxVoices, {}});
+  }
+
+  // Throws away the aliases of a sound so they are made again from the new
+  // one. Goes in AssetManager::beforeReload, which runs inside Update, so
+  // assetMutex is already held.
+  void DropVoices(Asset* sound) {
+    VoicePool* pool = FindPool(sound);
+    if (pool != nullptr) {
+      UnloadVoices(*pool);
+    }
+  }
+
+  // Call after InitAudioDevice and before any music is loaded, so the
+  // bigger stream buffers apply to it
+  static void ConfigureStreams() {
+    SetAudioStreamBufferSizeDefault(AUDIO_STREAM_BUFFER_FRAMES);
+  }
+
+  void Start() {
+    running = true;
+    thread = std::thread(&AudioThread::Loop, this);
+  }
+
+  // Has to run before the sounds and music are unloaded
+  void Stop() {
+    if (!thread.joinable()) {
+      return;
+    }
+    running = false;
+    thread.join();
+    for (VoicePool& pool : voicePools) {
+      UnloadVoices(pool);
+    }
+    if (music != nullptr) {
+      StopMusicStream(music->music);
+      music = nullptr;
+    }
+  }
+
+  void PlaySound(Asset* sound, float volume = 1.0f) {
+    Post({PLAY_SOUND_EVENT, sound, volume});
+  }
+
+  void PlayMusic(Asset* track, float volume) {
+    Post({PLAY_MUSIC_EVENT, track, volume});
+  }
+
+  // Quieter the further position is from the listener, usually the player
+  void PlaySoundAt(Asset* sound, Vector2 position, Vector2 listener) {
+    float distance = Vector2Distance(position, listener);
+    float volume = 1.0f - distance / AUDIO_FALLOFF_DISTANCE;
+    if (volume < AUDIO_MIN_VOLUME) {
+      ++culledSounds;
+      return;
+    }
+    PlaySound(sound, volume);
+  }
+
+  void StopMusic() { Post({STOP_MUSIC_EVENT, nullptr, 0}); }
+
+ private:
+  void Post(const AudioEvent& event) {
+    if (!queue.Push(event)) {
+      ++droppedEvents;
+    }
+  }
+
+  void Loop() {
+    while (running) {
+      {
+        std::lock_guard<std::mutex> lock(assetMutex);
+        AudioEvent event;
+        while (queue.Pop(event)) {
+          Handle(event);
+        }
+      }
+
+      if (music != nullptr) {
+        UpdateMusicStream(music->music);
+      }
+      std::this_thread::sleep_for(
+        std::chrono::milliseconds(AUDIO_UPDATE_INTERVAL_MS)
+      );
+    }
+  }
+
+  void Handle(const AudioEvent& event) {
+    switch (event.type) {
+      case PLAY_SOUND_EVENT:
+        if (event.asset->state != ASSET_READY) {
+          break;
+        }
+        if (VoicePool* pool = FindPool(event.asset)) {
+          PlayVoice(*pool, event.volume);
+        } else {
+          SetSoundVolume(event.asset->sound, event.volume);
+          ::PlaySound(event.asset->sound);
+        }
+        break;
+      case PLAY_MUSIC_EVENT:
+        if (music != nullptr) {
+          StopMusicStream(music->music);
+        }
+        music = event.asset->state == ASSET_READY ? event.asset : nullptr;
+        if (music != nullptr) {
+          SetMusicVolume(music->music, event.volume);
+          PlayMusicStream(music->music);
+        }
+        break;
+      case STOP_MUSIC_EVENT:
+        if (music != nullptr) {
+          StopMusicStream(music->music);
+          music = nullptr;
+        }
+        break;
+    }
+  }
+
+  VoicePool* FindPool(Asset* sound) {
+    for (VoicePool& pool : voicePools) {
+      if (pool.asset == sound) {
+        return &pool;
+      }
+    }
+    return nullptr;
+  }
+
+  void UnloadVoices(VoicePool& pool) {
+    for (Voice& voice : pool.voices) {
+      StopSound(voice.alias);
+      UnloadSoundAlias(voice.alias);
+    }
+    pool.voices.clear();
+  }
+
+  void PlayVoice(VoicePool& pool, float volume) {
+    if (pool.voices.empty()) {
+      for (int i = 0; i < pool.maxVoices; ++i) {
+        pool.voices.push_back({LoadSoundAlias(pool.asset->sound), 0, {}});
+      }
+    }
+
+    Voice* voice = nullptr;
+    for (Voice& candidate : pool.voices) {
+      if (!IsSoundPlaying(candidate.alias)) {
+        voice = &candidate;
+        break;
+      }
+    }
+
+    // A full pool steals one of its own voices, a full mixer steals from
+    // any pool
+    Voice* victim = nullptr;
+    auto now = std::chrono::steady_clock::now();
+    if (voice == nullptr) {
+      victim = FindVictim(pool, nullptr);
+    } else if (CountPlaying() >= AUDIO_MAX_VOICES) {
+      for (VoicePool& other : voicePools) {
+        victim = FindVictim(other, victim);
+      }
+    }
+    if (victim != nullptr) {
+      bool tooYoung =
+        now - victim->startedAt <
+        std::chrono::milliseconds(AUDIO_STEAL_MIN_AGE_MS);
+      if (volume < victim->volume ||
+          (volume == victim->volume && tooYoung)) {
+        ++culledSounds;
+        return;
+      }
+      StopSound(victim->alias);
+      if (voice == nullptr) {
+        voice = victim;
+      }
+    }
+
+    voice->volume = volume;
+    voice->startedAt = now;
+    SetSoundVolume(voice->alias, volume);
+    ::PlaySound(voice->alias);
+  }
+
+  // Quietest playing voice of the pool, the oldest among equals, or best if
+  // none of them beat it
+  Voice* FindVictim(VoicePool& pool, Voice* best) {
+    for (Voice& voice : pool.voices) {
+      if (!IsSoundPlaying(voice.alias)) {
+        continue;
+      }
+      if (best == nullptr || voice.volume < best->volume ||
+          (voice.volume == best->volume && voice.startedAt < best->startedAt)) {
+        best = &voice;
+      }
+    }
+    return best;
+  }
+
+  int CountPlaying() {
+    int playing = 0;
+    for (VoicePool& pool : voicePools) {
+      for (Voice& voice : pool.voices) {
+        playing += IsSoundPlaying(voice.alias);
+      }
+    }
+    return playing;
+  }
+};
+
+#endif
@@ -0,0 +1,189 @@
+#ifndef BEHAVIOR
+#define BEHAVIOR
+
+#include <coroutine>
+#include <exception>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "entity.hpp"
+#include "timerwheel.hpp"
+
+// Enemies only look sideways, the target has to be within this many units
+// of their height to be seen
+const float SIGHT_ROW_HEIGHT(10);
+
+// An enemy's decisions written as a coroutine. It starts suspended, Start
+// runs it up to the first thing it waits on, and from then on it is only
+// resumed by a BehaviorScheduler when that thing happens. Destroying it, or
+// assigning another behavior over it, stops the script wherever it is.
+struct Behavior {
+  struct promise_type {
+    Behavior get_return_object() {
+      return Behavior(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  std::coroutine_handle<promise_type> handle;
+
+  Behavior() = default;
+  explicit Behavior(std::coroutine_handle<promise_type> _handle)
+      : handle(_handle) {}
+  Behavior(Behavior&& other) noexcept
+      : handle(std::exchange(other.handle, nullptr)) {}
+  Behavior& operator=(Behavior&& other) noexcept {
+    if (this != &other) {
+      Stop();
+      handle = std::exchange(other.handle, nullptr);
+    }
+    return *this;
+  }
+  Behavior(const Behavior&) = delete;
+  Behavior& operator=(const Behavior&) = delete;
+  ~Behavior() { Stop(); }
+
+  void Start() {
+    if (handle && !handle.done()) {
+      handle.resume();
+    }
+  }
+
+  bool IsRunning() const { return handle && !handle.done(); }
+
+  // Whatever it was waiting on is let go of by the awaiters' destructors
+  void Stop() {
+    if (handle) {
+      handle.destroy();
+      handle = nullptr;
+    }
+  }
+};
+
+// Wakes behaviors up. Waiting a number of ticks goes on the gameplay timer
+// wheel, and waiting to see the target puts the enemy in an index sorted by
+// height, so each tick only the enemies on the target's row are looked at.
+// An idle enemy therefore costs nothing per tick, the work done scales with
+// the decisions being made rather than with the number of enemies.
+struct BehaviorScheduler {
+  struct SightAwaiter;
+  typedef std::multimap<float, SightAwaiter*> Rows;
+
+  // co_await Sleep(ticks), always suspends for at least one tick
+  struct SleepAwaiter {
+    BehaviorScheduler& scheduler;
+    uint64_t ticks;
+    TimerHandle timer;
+
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> waiting) {
+      timer = scheduler.timers.Schedule(ticks, [waiting] { waiting.resume(); });
+    }
+    void await_resume() {}
+    ~SleepAwaiter() { scheduler.timers.Cancel(timer); }
+  };
+
+  // co_await Sight(watcher, timeout) is true once the target is seen, or
+  // false when the timeout ran out first
+  struct SightAwaiter {
+    BehaviorScheduler& scheduler;
+    const Character* watcher;
+    uint64_t timeout;
+    std::coroutine_handle<> waiting;
+    TimerHandle timer;
+    Rows::iterator row;
+    bool listed = false;
+    bool seen = false;
+
+    bool await_ready() {
+      seen = scheduler.CanSee(watcher->position.y);
+      return seen;
+    }
+    void await_suspend(std::coroutine_handle<> _waiting) {
+      waiting = _waiting;
+      scheduler.Watch(this);
+      timer = scheduler.timers.Schedule(timeout, [this] {
+        scheduler.Unwatch(this);
+        waiting.resume();
+      });
+    }
+    bool await_resume() const { return seen; }
+    ~SightAwaiter() {
+      scheduler.timers.Cancel(timer);
+      scheduler.Unwatch(this);
+    }
+  };
+
+  TimerWheel& timers;
+  const Entity* target;
+  Rows rows;
+  std::unordered_map<const Character*, SightAwaiter*> watchers;
+  std::vector<SightAwaiter*> waking;
+
+  BehaviorScheduler(TimerWheel& _timers, const Entity* _target)
+      : timers(_timers), target(_target) {}
+
+  SleepAwaiter Sleep(uint64_t ticks) { return {*this, ticks, {}}; }
+
+  SightAwaiter Sight(const Character* watcher, uint64_t timeout) {
+    return {*this, watcher, timeout};
+  }
+
+  // Call once per tick, after the timers are advanced
+  void Sense() {
+    float y = target->position.y;
+    Rows::iterator it = rows.upper_bound(y - SIGHT_ROW_HEIGHT);
+    for (; it != rows.end() && it->first < y + SIGHT_ROW_HEIGHT; ++it) {
+      waking.push_back(it->second);
+    }
+    for (SightAwaiter* awaiter : waking) {
+      timers.Cancel(awaiter->timer);
+      Unwatch(awaiter);
+      awaiter->seen = true;
+      awaiter->waiting.resume();
+    }
+    waking.clear();
+  }
+
+  // A watching enemy changed rows, by falling or landing a jump. Moving
+  // along its row doesn't need this.
+  void Moved(const Character* watcher) {
+    auto found = watchers.find(watcher);
+    if (found == watchers.end()) {
+      return;
+    }
+    SightAwaiter* awaiter = found->second;
+    rows.erase(awaiter->row);
+    awaiter->row = rows.emplace(watcher->position.y, awaiter);
+  }
+
+  size_t Watching() const { return rows.size(); }
+
+  bool CanSee(float y) const {
+    return target->position.y < y + SIGHT_ROW_HEIGHT &&
+           target->position.y > y - SIGHT_ROW_HEIGHT;
+  }
+
+ private:
+  void Watch(SightAwaiter* awaiter) {
+    awaiter->row = rows.emplace(awaiter->watcher->position.y, awaiter);
+    awaiter->listed = true;
+    watchers[awaiter->watcher] = awaiter;
+  }
+
+  void Unwatch(SightAwaiter* awaiter) {
+    if (!awaiter->listed) {
+      return;
+    }
+    rows.erase(awaiter->row);
+    watchers.erase(awaiter->watcher);
+    awaiter->listed = false;
+  }
+};
+
+#endif
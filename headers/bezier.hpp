@@ -4,11 +4,9 @@
 #include <raylib.h>
 #include <raymath.h>
 
-#include <cstdio>
 #include <vector>
 
 const std::vector<std::vector<int>> BASE_PASCALS_TRIANGLE = {{1}, {1, 1}};
-std::vector<std::vector<int>> pascalsTriangle = BASE_PASCALS_TRIANGLE;
 
 std::vector<std::vector<int>> GeneratePascalsTriangle(const int depth) {
   std::vector<std::vector<int>> newPascalsTriangle = BASE_PASCALS_TRIANGLE;
@@ -25,13 +23,6 @@ std::vector<std::vector<int>> GeneratePascalsTriangle(const int depth) {
     newPascalsTriangle.push_back(row);
   }
 
-  for (size_t i = 0; i <= depth; ++i) {
-    for (size_t j = 0; j <= newPascalsTriangle[i].size() - 1; ++j) {
-      printf("%d ", newPascalsTriangle[i][j]);
-    }
-    printf("\n");
-  }
-
   return newPascalsTriangle;
 }
 
@@ -43,7 +34,7 @@ Vector2 GetPointInCurve(
   const std::vector<Vector2> points, const float distance,
   const std::vector<int> PTCoefficients
 ) {
-  Vector2 outputPoint;
+  Vector2 outputPoint = {0, 0};
   int n = points.size() - 1;
 
   for (size_t i = 0; i < points.size(); ++i) {
@@ -67,7 +58,8 @@ struct BezierCurve {
     }
   }
 
-  void CalculateCurve() {
+  // pascalsTriangle needs a row for every point
+  void CalculateCurve(const std::vector<std::vector<int>>& pascalsTriangle) {
     if (!stepList.empty()) stepList.clear();
     for (int i = 0; i < numberOfSteps; ++i) {
       Vector2 stepPoint;
@@ -0,0 +1,155 @@
+#ifndef BROADPHASE
+#define BROADPHASE
+
+#include <raylib.h>
+
+#include <vector>
+
+#include "entity.hpp"
+
+// Sort-and-sweep broadphase on the x axis for keeping enemies from stacking
+// on top of each other. Proxies stay sorted by the left edge of their
+// collider between frames, so after a tick of movement the list is almost
+// sorted and an insertion sort puts it back in order in close to linear time.
+
+struct SweepAndPrune {
+  struct Proxy {
+    Character* body;
+    float minX;
+    float maxX;
+  };
+
+  std::vector<Proxy> proxies;
+  int pairTests = 0;  // y-overlap checks done by the last sweep
+  int contacts = 0;   // pairs pushed apart by the last sweep
+
+  void Insert(Character* body) {
+    Proxy proxy = {body, 0, 0};
+    RefreshBounds(proxy);
+
+    // Keep the list sorted so the next Update stays cheap
+    size_t i = proxies.size();
+    proxies.push_back(proxy);
+    while (i > 0 && proxies[i - 1].minX > proxy.minX) {
+      proxies[i] = proxies[i - 1];
+      --i;
+    }
+    proxies[i] = proxy;
+  }
+
+  void Remove(Character* body) {
+    for (size_t i = 0; i < proxies.size(); ++i) {
+      if (proxies[i].body == body) {
+        proxies.erase(proxies.begin() + i);
+        return;
+      }
+    }
+  }
+
+  void Clear() { proxies.clear(); }
+
+  // Pull in the new collider bounds and restore the ordering
+  void Update() {
+    for (Proxy& p : proxies) {
+      RefreshBounds(p);
+    }
+    InsertionSort();
+  }
+
+  // Push overlapping bodies apart horizontally. Vertical overlap is left to
+  // gravity and the platforms, since separating vertically would fight the
+  // ground collision.
+  void Separate(const std::vector<Obstacle*>& obstacles) {
+    pairTests = 0;
+    contacts = 0;
+
+    for (size_t i = 0; i < proxies.size(); ++i) {
+      for (size_t j = i + 1; j < proxies.size(); ++j) {
+        if (proxies[j].minX >= proxies[i].maxX) {
+          break;  // Sorted by minX, nothing further along can overlap i
+        }
+
+        ++pairTests;
+        Character* a = proxies[i].body;
+        Character* b = proxies[j].body;
+        float overlapY = (a->halfSizes.y + b->halfSizes.y) -
+                         fabsf(a->position.y - b->position.y);
+        if (overlapY <= 0) {
+          continue;
+        }
+
+        float overlapX = fminf(proxies[i].maxX, proxies[j].maxX) -
+                         fmaxf(proxies[i].minX, proxies[j].minX);
+        if (overlapX <= 0) {
+          continue;
+        }
+
+        ++contacts;
+        // i is the leftmost by minX, so it goes left and j goes right
+        PushApart(a, b, overlapX, obstacles);
+        RefreshBounds(proxies[i]);
+        RefreshBounds(proxies[j]);
+      }
+    }
+  }
+
+ private:
+  void RefreshBounds(Proxy& proxy) {
+    proxy.minX = proxy.body->position.x - proxy.body->halfSizes.x;
+    proxy.maxX = proxy.body->position.x + proxy.body->halfSizes.x;
+  }
+
+  void InsertionSort() {
+    for (size_t i = 1; i < proxies.size(); ++i) {
+      Proxy p = proxies[i];
+      size_t j = i;
+      while (j > 0 && proxies[j - 1].minX > p.minX) {
+        proxies[j] = proxies[j - 1];
+        --j;
+      }
+      proxies[j] = p;
+    }
+  }
+
+  // Split the push between both bodies. If one of them would end up inside
+  // an obstacle it stays put and the other takes the whole push, so enemies
+  // never get shoved through walls.
+  void PushApart(
+    Character* left, Character* right, float overlap,
+    const std::vector<Obstacle*>& obstacles
+  ) {
+    float half = overlap / 2;
+    bool leftBlocked = IsBlocked(left, -half, obstacles);
+    bool rightBlocked = IsBlocked(right, half, obstacles);
+
+    if (leftBlocked && rightBlocked) {
+      return;
+    } else if (leftBlocked) {
+      if (!IsBlocked(right, overlap, obstacles)) {
+        right->position.x += overlap;
+      }
+    } else if (rightBlocked) {
+      if (!IsBlocked(left, -overlap, obstacles)) {
+        left->position.x -= overlap;
+      }
+    } else {
+      left->position.x -= half;
+      right->position.x += half;
+    }
+  }
+
+  bool IsBlocked(
+    Character* body, float offsetX, const std::vector<Obstacle*>& obstacles
+  ) {
+    Rectangle moved = body->GetCollider();
+    moved.x += offsetX;
+    for (Obstacle* o : obstacles) {
+      if (CheckCollisionRecs(moved, o->GetCollider())) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef CAMERA_HELPERS
+#define CAMERA_HELPERS
+
+#include <raylib.h>
+#include <raymath.h>
+
+// World-space rectangle seen through the camera. Works off the screen
+// corners, so zoom, offset, target and rotation are all accounted for.
+Rectangle GetCameraBounds(
+  const Camera2D camera, const float screenWidth, const float screenHeight
+) {
+  Vector2 corners[4] = {
+    GetScreenToWorld2D({0, 0}, camera),
+    GetScreenToWorld2D({screenWidth, 0}, camera),
+    GetScreenToWorld2D({0, screenHeight}, camera),
+    GetScreenToWorld2D({screenWidth, screenHeight}, camera),
+  };
+
+  Vector2 upperLeft = corners[0];
+  Vector2 lowerRight = corners[0];
+  for (int i = 1; i < 4; ++i) {
+    upperLeft.x = fminf(upperLeft.x, corners[i].x);
+    upperLeft.y = fminf(upperLeft.y, corners[i].y);
+    lowerRight.x = fmaxf(lowerRight.x, corners[i].x);
+    lowerRight.y = fmaxf(lowerRight.y, corners[i].y);
+  }
+
+  return {
+    upperLeft.x,
+    upperLeft.y,
+    lowerRight.x - upperLeft.x,
+    lowerRight.y - upperLeft.y,
+  };
+}
+
+// Grows a rectangle by margin on every side
+Rectangle ExpandRectangle(const Rectangle rec, const float margin) {
+  return {
+    rec.x - margin,
+    rec.y - margin,
+    rec.width + margin * 2,
+    rec.height + margin * 2,
+  };
+}
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef CULLING
+#define CULLING
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <list>
+#include <vector>
+
+#include "camera.hpp"
+#include "enemies.hpp"
+#include "entity.hpp"
+#include "level.hpp"
+
+const float CULL_CELL_SIZE(200);
+// Enemy sprites are drawn bigger than their colliders and rotated, this
+// covers the furthest a sprite pixel can get from the collider
+const float CULL_SPRITE_MARGIN(60);
+
+// Uniform grid over the static level geometry. Static obstacles never move,
+// so the grid is built once after the level loads and only queried after.
+struct SpatialGrid {
+  Vector2 origin;
+  int columns = 0;
+  int rows = 0;
+  std::vector<std::vector<int>> cells;
+  std::vector<Obstacle*> entries;
+  std::vector<unsigned int> entryStamps;  // last query that returned it
+  unsigned int queryStamp = 0;
+
+  void Build(const std::vector<Obstacle*>& obstacles) {
+    entries.clear();
+    for (Obstacle* o : obstacles) {
+      if (o->type == ObstacleType::STATIC) {
+        entries.push_back(o);
+      }
+    }
+    entryStamps.assign(entries.size(), 0);
+    queryStamp = 0;
+
+    if (entries.empty()) {
+      columns = 0;
+      rows = 0;
+      cells.clear();
+      return;
+    }
+
+    Rectangle first = entries[0]->GetCollider();
+    Vector2 upperLeft = {first.x, first.y};
+    Vector2 lowerRight = {first.x + first.width, first.y + first.height};
+    for (Obstacle* o : entries) {
+      Rectangle c = o->GetCollider();
+      upperLeft.x = fminf(upperLeft.x, c.x);
+      upperLeft.y = fminf(upperLeft.y, c.y);
+      lowerRight.x = fmaxf(lowerRight.x, c.x + c.width);
+      lowerRight.y = fmaxf(lowerRight.y, c.y + c.height);
+    }
+
+    origin = upperLeft;
+    columns = (int)((lowerRight.x - upperLeft.x) / CULL_CELL_SIZE) + 1;
+    rows = (int)((lowerRight.y - upperLeft.y) / CULL_CELL_SIZE) + 1;
+    cells.assign(columns * rows, {});
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+      int x0, y0, x1, y1;
+      if (!GetCellRange(entries[i]->GetCollider(), x0, y0, x1, y1)) {
+        continue;
+      }
+      for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+          cells[y * columns + x].push_back(i);
+        }
+      }
+    }
+  }
+
+  // Appends every obstacle touching area to out, each one only once
+  void Query(const Rectangle area, std::vector<Obstacle*>& out) {
+    int x0, y0, x1, y1;
+    if (!GetCellRange(area, x0, y0, x1, y1)) {
+      return;
+    }
+
+    ++queryStamp;
+    for (int y = y0; y <= y1; ++y) {
+      for (int x = x0; x <= x1; ++x) {
+        for (int i : cells[y * columns + x]) {
+          if (entryStamps[i] == queryStamp) {
+            continue;  // Spans several cells, already looked at
+          }
+          entryStamps[i] = queryStamp;
+          if (CheckCollisionRecs(area, entries[i]->GetCollider())) {
+            out.push_back(entries[i]);
+          }
+        }
+      }
+    }
+  }
+
+ private:
+  // Cells overlapped by rec, clamped to the grid. False if rec misses it.
+  bool GetCellRange(Rectangle rec, int& x0, int& y0, int& x1, int& y1) {
+    if (columns == 0 || rows == 0) {
+      return false;
+    }
+    x0 = (int)floorf((rec.x - origin.x) / CULL_CELL_SIZE);
+    y0 = (int)floorf((rec.y - origin.y) / CULL_CELL_SIZE);
+    x1 = (int)floorf((rec.x + rec.width - origin.x) / CULL_CELL_SIZE);
+    y1 = (int)floorf((rec.y + rec.height - origin.y) / CULL_CELL_SIZE);
+    if (x1 < 0 || y1 < 0 || x0 >= columns || y0 >= rows) {
+      return false;
+    }
+    x0 = x0 < 0 ? 0 : x0;
+    y0 = y0 < 0 ? 0 : y0;
+    x1 = x1 >= columns ? columns - 1 : x1;
+    y1 = y1 >= rows ? rows - 1 : y1;
+    return true;
+  }
+};
+
+// What survived culling this frame. The vectors are reused every frame so
+// gathering doesn't allocate once they've grown to size.
+struct VisibleSet {
+  Rectangle view;
+  std::vector<Obstacle*> obstacles;
+  std::vector<Bullet*> bullets;
+  std::vector<MeleeEnemy*> meleeEnemies;
+  std::vector<RangedEnemy*> rangedEnemies;
+  std::vector<Item*> items;
+
+  void Clear() {
+    obstacles.clear();
+    bullets.clear();
+    meleeEnemies.clear();
+    rangedEnemies.clear();
+    items.clear();
+  }
+};
+
+struct Culler {
+  SpatialGrid staticGrid;
+  std::vector<Obstacle*> movingObstacles;
+
+  void Build(const std::vector<Obstacle*>& obstacles) {
+    staticGrid.Build(obstacles);
+    movingObstacles.clear();
+    for (Obstacle* o : obstacles) {
+      if (o->type == ObstacleType::MOVING) {
+        movingObstacles.push_back(o);
+      }
+    }
+  }
+
+  void Gather(
+    const Camera2D camera, const float screenWidth, const float screenHeight,
+    Level* level, const std::list<MeleeEnemy*>& meleeEnemies, VisibleSet& out
+  ) {
+    out.Clear();
+    out.view = GetCameraBounds(camera, screenWidth, screenHeight);
+    Rectangle spriteView = ExpandRectangle(out.view, CULL_SPRITE_MARGIN);
+
+    staticGrid.Query(out.view, out.obstacles);
+    for (Obstacle* o : movingObstacles) {
+      if (o->IsIntersecting(out.view)) {
+        out.obstacles.push_back(o);
+      }
+    }
+
+    for (Bullet* b : level->bullets) {
+      if (b->IsIntersecting(out.view)) {
+        out.bullets.push_back(b);
+      }
+    }
+    for (RangedEnemy* r : level->rangedEnemies) {
+      if (r->IsIntersecting(spriteView)) {
+        out.rangedEnemies.push_back(r);
+      }
+    }
+    for (MeleeEnemy* m : meleeEnemies) {
+      if (m->IsIntersecting(spriteView)) {
+        out.meleeEnemies.push_back(m);
+      }
+    }
+    for (Item* i : level->items) {
+      if (i->IsIntersecting(spriteView)) {
+        out.items.push_back(i);
+      }
+    }
+  }
+};
+
+#endif
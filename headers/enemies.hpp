@@ -1,16 +1,22 @@
 #ifndef ENEMIES
 #define ENEMIES
 
+#include <algorithm>
+
+#include "behavior.hpp"
 #include "entity.hpp"
 
-struct RangedEnemy : public Character
+struct RangedEnemy final : public Character
 {
   Heading heading = Heading::LEFT;
+  int SHOT_INTERVAL = 100;  // ticks between shots on average
+  uint64_t wakeTick = 0;    // when Shooter shoots next, 0 before it picked
+  Behavior behavior;
 
   RangedEnemy(Vector2 _position, Vector2 _halfSizes, Color _color = RANGED_ENEMY_COLOR) : Character(_position, _halfSizes, _color) {};
 
   void Update(
-      const Properties *properties, const std::vector<Obstacle *> obstacles)
+      const Properties *properties, const std::vector<Obstacle *> &obstacles)
   {
     MoveHorizontal(properties);
     CollideHorizontal(obstacles, properties->gap);
@@ -28,6 +34,27 @@ struct RangedEnemy : public Character
 		return IsIntersecting(player->GetCollider());
 	}
 
+  // Shoots at the player every so often, unless frozen far off screen.
+  // Everything it remembers is in wakeTick, so starting it again on a
+  // restored enemy carries on the same wait.
+  Behavior Shooter(
+      BehaviorScheduler &scheduler, Player *player, std::vector<Bullet *> &bullets)
+  {
+    while (true)
+    {
+      if (wakeTick == 0)
+      {
+        wakeTick = scheduler.timers.now + 1 + random.Below(2 * SHOT_INTERVAL);
+      }
+      co_await scheduler.Sleep(wakeTick - scheduler.timers.now);
+      wakeTick = 0;
+      if (updateTier != DORMANT)
+      {
+        bullets.push_back(Shoot(player));
+      }
+    }
+  }
+
 private:
   void MoveHorizontal(const Properties *properties)
   {
@@ -71,7 +98,7 @@ private:
     {
       velocity.x = 0.0f;
     }
-    position.x += velocity.x;
+    position.x += velocity.x * timeScale;
   }
 
   void MoveVertical(const Properties *properties)
@@ -82,7 +109,7 @@ private:
   }
 
   void CollideHorizontal(
-      const std::vector<Obstacle *> obstacles, const float gap)
+      const std::vector<Obstacle *> &obstacles, const float gap)
   {
     // Ledge check, don't fall!
     Obstacle *oLeft = nullptr;
@@ -138,7 +165,7 @@ private:
   }
 
   void CollideVertical(
-      const std::vector<Obstacle *> obstacles, const float gap)
+      const std::vector<Obstacle *> &obstacles, const float gap)
   {
     for (Obstacle *o : obstacles)
     {
@@ -186,73 +213,129 @@ private:
   }
 };
 
-struct MeleeEnemy : public Character
+struct MeleeEnemy final : public Character
 {
   bool isMovingLeft = true;
   bool isMovingRight = false;
   bool isJumping = false;
+  bool isGrounded = false;
   int jumpFrame = 0;
-  int JUMP_CHANCE = 95;
+  int JUMP_INTERVAL = 25;  // ticks between hops on average while wandering
   bool isFollowingPlayer = false;
   using Character::Character;
   float speedModifier = 0.5;
-
-  void Update(
-      const Properties *properties, const std::vector<Obstacle *> obstacles, Player *player)
+  // Where Patrol is, so it can be started again on a restored enemy and
+  // carry on. untilTurn is the wandering left as of the end of the current
+  // wait, wakeTick when that wait ends, 0 between waits.
+  int untilTurn = 0;
+  uint64_t wakeTick = 0;
+  BehaviorScheduler *brain = nullptr;  // set while Patrol runs
+  Behavior behavior;
+
+  // Physics only, where to go is decided by Patrol. True when it ran into
+  // the player.
+  bool Update(
+      const Properties *properties, const std::vector<Obstacle *> &obstacles, Player *player)
   {
-    findPlayer(player);
-    checkIfJump();
     MoveHorizontal(properties);
     CollideHorizontal(obstacles, properties->gap);
     MoveVertical(properties);
     CollideVertical(obstacles, properties->gap);
-    CollidePlayer(player);
+    return CollidePlayer(player);
   }
 
-  void findPlayer(Player *p)
+  // Wanders, hopping now and then and turning around every few seconds,
+  // until the player shows up on its row. Then chases the player for as
+  // long as they stay on that row, deciding again every tick.
+  Behavior Patrol(BehaviorScheduler &scheduler, Player *player)
   {
-    if (p->position.y < position.y+10 && p->position.y > position.y-10)
+    brain = &scheduler;
+    if (untilTurn <= 0 && wakeTick == 0)
+    {
+      untilTurn = randomizeMoveTimer();
+    }
+    while (true)
     {
-      isFollowingPlayer = true;
-      //std::cout << "FOLLOWING" << std::endl;
-      if (p->position.x > position.x)
+      if (!isFollowingPlayer)
       {
-        isMovingLeft = false;
-        isMovingRight = true;
+        if (wakeTick == 0)
+        {
+          int wait = std::min(untilTurn, randomizeJumpTimer());
+          untilTurn -= wait;
+          wakeTick = scheduler.timers.now + wait;
+        }
+        if (!co_await scheduler.Sight(this, wakeTick - scheduler.timers.now))
+        {
+          wakeTick = 0;
+          if (untilTurn <= 0)
+          {
+            turnAround();
+            untilTurn = randomizeMoveTimer();
+          }
+          else
+          {
+            isJumping = true;
+          }
+          continue;
+        }
+        // Spotted early, the rest of the wait is wandered after the chase
+        untilTurn += wakeTick - scheduler.timers.now;
+        wakeTick = 0;
+        isFollowingPlayer = true;
       }
-      else if (p->position.x < position.x)
+
+      while (true)
       {
-        isMovingLeft = true;
-        isMovingRight = false;
+        if (wakeTick == 0)
+        {
+          if (!scheduler.CanSee(position.y))
+          {
+            break;
+          }
+          followPlayer(player);
+          wakeTick = scheduler.timers.now + 1;
+        }
+        co_await scheduler.Sleep(wakeTick - scheduler.timers.now);
+        wakeTick = 0;
       }
-    }
-    else{
       isFollowingPlayer = false;
-      //std::cout << "NOT FOLLOWING"<< std::endl;
     }
   }
 
-  void checkIfJump()
+  void followPlayer(Player *p)
   {
-    int rng_num;
-    if (isJumping == false && !isFollowingPlayer)
+    if (p->position.x > position.x)
     {
-      rng_num = rand() % 100;
-      if (rng_num > JUMP_CHANCE)
-      {
-        isJumping = true;
-        //std::cout << "GONNA JUMP" << std::endl;
-      }
+      isMovingLeft = false;
+      isMovingRight = true;
+    }
+    else if (p->position.x < position.x)
+    {
+      isMovingLeft = true;
+      isMovingRight = false;
     }
   }
 
+  // In ticks, how long to wander one way before turnAround
   int randomizeMoveTimer()
   {
     int rng_num;
-    rng_num = rand() % 200;
+    rng_num = random.Below(200);
     return rng_num + 100;
   }
 
+  // In ticks, until the next hop
+  int randomizeJumpTimer()
+  {
+    return 1 + random.Below(2 * JUMP_INTERVAL);
+  }
+
+  void turnAround()
+  {
+    isMovingLeft = !isMovingLeft;
+    isMovingRight = !isMovingLeft;
+  }
+
   void MoveHorizontal(const Properties *properties)
   {
     if (isMovingLeft)
@@ -290,7 +373,7 @@ struct MeleeEnemy : public Character
       velocity.x *= properties->hCoeff; // Slow down
     }
 
-    position.x += velocity.x;
+    position.x += velocity.x * timeScale;
   }
 
   void MoveVertical(const Properties *properties)
@@ -322,7 +405,7 @@ struct MeleeEnemy : public Character
   }
 
   void CollideHorizontal(
-      const std::vector<Obstacle *> obstacles, const float gap)
+      const std::vector<Obstacle *> &obstacles, const float gap)
   {
 
     // Collide with walls
@@ -359,8 +442,10 @@ struct MeleeEnemy : public Character
   }
 
   void CollideVertical(
-      const std::vector<Obstacle *> obstacles, const float gap)
+      const std::vector<Obstacle *> &obstacles, const float gap)
   {
+    bool wasGrounded = isGrounded;
+    isGrounded = false;
     for (Obstacle *o : obstacles)
     {
       Rectangle oCollider = o->GetCollider();
@@ -383,6 +468,7 @@ struct MeleeEnemy : public Character
           velocity.y = 0;
           jumpFrame = 0;
           isJumping = false;
+          isGrounded = true;
         }
         else
         { // Na-untog
@@ -392,16 +478,23 @@ struct MeleeEnemy : public Character
         break;
       }
     }
+
+    // Landed on another row, so it looks for the player there now
+    if (isGrounded && !wasGrounded && brain)
+    {
+      brain->Moved(this);
+    }
   }
 
-  void CollidePlayer(Player* p){
+  bool CollidePlayer(Player* p){
     Rectangle playerCollider = p->GetCollider();
     if (IsIntersecting(playerCollider))
     {
       p->health -= 1;
-      std::cout << "Health: " << p->health << std::endl;
       kill();
+      return true;
     }
+    return false;
   }
 };
 
@@ -6,8 +6,12 @@
 
 #include <vector>
 
+#include "atlas.hpp"
 #include "bezier.hpp"
+#include "input.hpp"
 #include "properties.hpp"
+#include "random.hpp"
+#include "renderqueue.hpp"
 
 const float PLAYER_WIDTH(24);
 const float PLAYER_HEIGHT(48);
@@ -26,6 +30,7 @@ const Color MOVING_OBSTACLE_COLOR(PURPLE);
 
 enum ObstacleType { STATIC, MOVING };
 enum Heading { LEFT, RIGHT };
+enum UpdateTier { FULL_RATE, REDUCED_RATE, DORMANT };
 
 // All entity positions are assumed to be indicated by their centers, not
 // upper-lefts
@@ -35,6 +40,9 @@ struct Entity {
   Vector2 halfSizes;
   Color color;
 
+  // Every IsIntersecting call on this thread, for the frame stats overlay
+  static inline thread_local long intersectionTests = 0;
+
   Entity() = default;
 
   Entity(
@@ -45,7 +53,9 @@ struct Entity {
     this->color = _color;
   }
 
-  void Draw() { DrawRectangleRec(GetCollider(), color); }
+  void Submit(RenderQueue& queue, int layer) {
+    queue.Rect(layer, GetCollider(), color);
+  }
 
   Rectangle GetCollider() {
     return {
@@ -57,6 +67,7 @@ struct Entity {
   }
 
   bool IsIntersecting(Rectangle rec) {
+    ++intersectionTests;
     return CheckCollisionRecs(rec, GetCollider());
   }
 };
@@ -101,7 +112,15 @@ struct Obstacle : public Entity {
 
 struct Character : public Entity {
   Vector2 velocity;
-  int health;
+  int health = 0;  // only the player uses it
+
+  // Set by the SimulationScheduler. timeScale is how many ticks the next
+  // update stands in for.
+  UpdateTier updateTier = UpdateTier::FULL_RATE;
+  int ticksSinceUpdate = 0;
+  float timeScale = 1.0f;
+
+  GameRandom random;  // seeded by the World
 
   Character(
     Vector2 _position, Vector2 _halfSizes, Color _color = MELEE_ENEMY_COLOR
@@ -115,35 +134,35 @@ struct Character : public Entity {
   virtual void MoveHorizontal(const Properties* properties) = 0;
   virtual void MoveVertical(const Properties* properties) = 0;
   virtual void CollideHorizontal(
-    const std::vector<Obstacle*> obstacles, const float gap
+    const std::vector<Obstacle*>& obstacles, const float gap
   ) = 0;
   virtual void CollideVertical(
-    const std::vector<Obstacle*> obstacles, const float gap
+    const std::vector<Obstacle*>& obstacles, const float gap
   ) = 0;
 
   void kill() {
     if (position.y < 400) {
       position.y = 600;
-      position.x = rand() % 700 + 100;
+      position.x = random.Below(700) + 100;
     } else {
       position.y = 200;
-      position.x = rand() % 700 + 100;
+      position.x = random.Below(700) + 100;
     }
   }
 
  protected:
   void HandleGravity(const Properties* properties) {
-    velocity.y += properties->gravity;
+    velocity.y += properties->gravity * timeScale;
   }
 
   void LimitVerticalVelocity(const Properties* properties) {
     velocity.y = Clamp(velocity.y, -INT32_MAX, properties->vVelMax);
   }
 
-  void ApplyVerticalVelocity() { position.y += velocity.y; }
+  void ApplyVerticalVelocity() { position.y += velocity.y * timeScale; }
 };
 
-struct Player : public Character {
+struct Player final : public Character {
   float airControlFactor = 1.0f;
   bool isGrounded = false;
   int jumpFrame = 0;
@@ -151,6 +170,7 @@ struct Player : public Character {
   int kills = 0;
   int killsThreshold = 0;
   std::string facingDirection = "right";
+  InputBuffer* input = nullptr;  // read once per tick
 
   Player(
     Vector2 _position, Vector2 _halfSizes, int _health = MAX_PLAYER_HEALTH,
@@ -168,7 +188,7 @@ struct Player : public Character {
       airControlFactor = 1.0f;
     }
 
-    if (IsKeyDown(KEY_A)) {
+    if (input->IsDown(ACTION_LEFT)) {
       facingDirection = "left";
       if (velocity.x > 0.0f) {
         velocity.x -=
@@ -179,7 +199,7 @@ struct Player : public Character {
       if (abs(velocity.x) >= properties->hVelMax) {
         velocity.x = -properties->hVelMax;
       }
-    } else if (IsKeyDown(KEY_D)) {
+    } else if (input->IsDown(ACTION_RIGHT)) {
       facingDirection = "right";
       if (velocity.x < 0.0f) {
         velocity.x +=
@@ -202,12 +222,13 @@ struct Player : public Character {
   }
 
   void MoveVertical(const Properties* properties) {
-    // Jump handling
-    if (IsKeyPressed(KEY_SPACE) && jumpFrame <= 0 && framesAfterFallingOff <= properties->vSafe)
+    // Jump handling, a press shortly before landing jumps on landing
+    if (jumpFrame <= 0 && framesAfterFallingOff <= properties->vSafe &&
+        input->Consume(ACTION_JUMP, JUMP_BUFFER_TIME))
     {
       velocity.y = properties->vAccel;
       ++jumpFrame;
-    } else if (IsKeyDown(KEY_SPACE) && velocity.y < 0) {  // In jump
+    } else if (input->IsDown(ACTION_JUMP) && velocity.y < 0) {  // In jump
       if (jumpFrame < properties->vHold) {
         velocity.y = properties->vAccel *
                      ((properties->vHold - jumpFrame) / properties->vHold);
@@ -218,7 +239,7 @@ struct Player : public Character {
         }
       }
     }
-    if (IsKeyReleased(KEY_SPACE)) {
+    if (input->WasReleased(ACTION_JUMP)) {
       if (velocity.y < properties->vVelCut) {
         velocity.y = properties->vVelCut;
       }
@@ -230,7 +251,7 @@ struct Player : public Character {
   }
 
   void CollideHorizontal(
-    const std::vector<Obstacle*> obstacles, const float gap
+    const std::vector<Obstacle*>& obstacles, const float gap
   ) {
     for (Obstacle* o : obstacles) {
       Rectangle oCollider = o->GetCollider();
@@ -251,7 +272,7 @@ struct Player : public Character {
   }
 
   void CollideVertical(
-    const std::vector<Obstacle*> obstacles, const float gap
+    const std::vector<Obstacle*>& obstacles, const float gap
   ) {
     bool isGroundedLastFrame = isGrounded;
 
@@ -302,7 +323,9 @@ struct Bullet : public Entity {
     this->speed = _speed;
   }
 
-  void Draw() { DrawCircleV(position, halfSizes.x, color); }
+  void Submit(RenderQueue& queue, int layer) {
+    queue.Circle(layer, position, halfSizes.x, color);
+  }
 
   void Update(const float timestep) {
     position = Vector2Add(
@@ -332,10 +355,14 @@ struct Item : public Entity {
     return false;
   }
 
-  void Draw(Texture texture) {
-    DrawCircleV(position, 15, GREEN);
-    DrawTextureV(
-      texture, Vector2Subtract(position, Vector2Scale(halfSizes, 0.5)), WHITE
+  // The icon needs a layer above the circle's to be sure to land on top
+  void Submit(
+    RenderQueue& queue, int layer, int iconLayer, SpriteRegion sprite
+  ) {
+    queue.Circle(layer, position, 15, GREEN);
+    queue.SpriteAt(
+      iconLayer, sprite.texture, sprite.source,
+      Vector2Subtract(position, Vector2Scale(halfSizes, 0.5))
     );
   }
 };
@@ -348,7 +375,7 @@ struct PlayerWeapon : public Entity {
     this->color = _color;
   }
 
-  void Update(Player* player, std::vector<Bullet*> bullets) {
+  void Update(Player* player, const std::vector<Bullet*>& bullets) {
     if (player->facingDirection == "left") {
       position.x = player->position.x - 50;
     } else {
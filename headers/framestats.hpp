@@ -0,0 +1,211 @@
+#ifndef FRAME_STATS
+#define FRAME_STATS
+
+#include <raylib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include "entity.hpp"
+
+// Samples kept for the rolling statistics, about four seconds at 60fps
+const int FRAME_STATS_WINDOW(240);
+const int FRAME_STATS_BUCKETS(40);
+const int FRAME_STATS_FONT_SIZE(10);
+const int FRAME_STATS_GRAPH_HEIGHT(30);
+
+// The last FRAME_STATS_WINDOW values, oldest overwritten first
+struct RollingSamples {
+  float samples[FRAME_STATS_WINDOW] = {};
+  int next = 0;
+  int count = 0;
+
+  void Add(float value) {
+    samples[next] = value;
+    next = (next + 1) % FRAME_STATS_WINDOW;
+    if (count < FRAME_STATS_WINDOW) {
+      ++count;
+    }
+  }
+};
+
+struct SampleSummary {
+  float p50 = 0;
+  float p99 = 0;
+  float max = 0;
+  int buckets[FRAME_STATS_BUCKETS] = {};  // evenly split from 0 to max
+  int tallest = 0;
+};
+
+// What the frame stats overlay shows that isn't timed, set by the game
+struct FrameCounts {
+  int meleeEnemies = 0;
+  int rangedEnemies = 0;
+  int bullets = 0;
+  int particles = 0;
+  int pairTests = 0;  // by the crowd broadphase
+};
+
+// Rolling frame and tick times with a few counters, shown as an overlay.
+// Recording only writes into fixed arrays, percentiles and histograms are
+// worked out while the overlay is drawn, so leaving it on or off makes no
+// difference to the frames being measured.
+struct FrameStats {
+  RollingSamples frameMs;
+  RollingSamples tickMs;
+  RollingSamples ticksPerFrame;
+  RollingSamples allocationsPerFrame;
+  FrameCounts counts;
+  bool showOverlay = false;
+
+  // This frame so far
+  int ticks = 0;
+  long testsInTicks = 0;
+  std::chrono::steady_clock::time_point tickStart;
+  long testsAtTickStart = 0;
+
+  // Last frame, for the overlay
+  int lastTicks = 0;
+  long lastTestsInTicks = 0;
+  long lastAllocations = 0;
+  long lastAllocationBytes = 0;
+  long allocationsAtFrameStart = 0;
+  long bytesAtFrameStart = 0;
+
+  void BeginTick() {
+    tickStart = std::chrono::steady_clock::now();
+    testsAtTickStart = Entity::intersectionTests;
+  }
+
+  void EndTick() {
+    std::chrono::duration<float, std::milli> elapsed =
+      std::chrono::steady_clock::now() - tickStart;
+    tickMs.Add(elapsed.count());
+    testsInTicks += Entity::intersectionTests - testsAtTickStart;
+    ++ticks;
+  }
+
+  // frameSeconds is GetFrameTime(), the allocation totals are the running
+  // totals since the start
+  void EndFrame(float frameSeconds, long allocations, long allocationBytes) {
+    frameMs.Add(frameSeconds * 1000);
+    ticksPerFrame.Add(ticks);
+    lastTicks = ticks;
+    lastTestsInTicks = testsInTicks;
+    ticks = 0;
+    testsInTicks = 0;
+
+    lastAllocations = allocations - allocationsAtFrameStart;
+    lastAllocationBytes = allocationBytes - bytesAtFrameStart;
+    allocationsPerFrame.Add(lastAllocations);
+    allocationsAtFrameStart = allocations;
+    bytesAtFrameStart = allocationBytes;
+  }
+
+  void Draw(int x, int y) {
+    const int width = 330;
+    const int lineHeight = FRAME_STATS_FONT_SIZE + 4;
+    const int height = 7 * lineHeight + 2 * (FRAME_STATS_GRAPH_HEIGHT + 4);
+    DrawRectangle(x - 5, y - 5, width + 10, height + 10, {0, 0, 0, 170});
+    char line[128];
+
+    SampleSummary frames = Summarize(frameMs);
+    snprintf(
+      line, sizeof(line), "frame ms  p50 %.2f  p99 %.2f  max %.2f",
+      frames.p50, frames.p99, frames.max
+    );
+    DrawText(line, x, y, FRAME_STATS_FONT_SIZE, GREEN);
+    y += lineHeight;
+    DrawHistogram(frames, x, y, width, GREEN);
+    y += FRAME_STATS_GRAPH_HEIGHT + 4;
+
+    SampleSummary tickTimes = Summarize(tickMs);
+    snprintf(
+      line, sizeof(line), "tick ms  p50 %.3f  p99 %.3f  max %.3f",
+      tickTimes.p50, tickTimes.p99, tickTimes.max
+    );
+    DrawText(line, x, y, FRAME_STATS_FONT_SIZE, SKYBLUE);
+    y += lineHeight;
+    DrawHistogram(tickTimes, x, y, width, SKYBLUE);
+    y += FRAME_STATS_GRAPH_HEIGHT + 4;
+
+    SampleSummary tickCounts = Summarize(ticksPerFrame);
+    snprintf(
+      line, sizeof(line), "ticks/frame  last %d  p50 %.0f  max %.0f",
+      lastTicks, tickCounts.p50, tickCounts.max
+    );
+    DrawText(line, x, y, FRAME_STATS_FONT_SIZE, WHITE);
+    y += lineHeight;
+
+    snprintf(
+      line, sizeof(line), "enemies %d melee %d ranged  bullets %d",
+      counts.meleeEnemies, counts.rangedEnemies, counts.bullets
+    );
+    DrawText(line, x, y, FRAME_STATS_FONT_SIZE, WHITE);
+    y += lineHeight;
+
+    snprintf(line, sizeof(line), "particles %d", counts.particles);
+    DrawText(line, x, y, FRAME_STATS_FONT_SIZE, WHITE);
+    y += lineHeight;
+
+    snprintf(
+      line, sizeof(line), "collision tests/tick %ld  crowd pair tests %d",
+      lastTicks > 0 ? lastTestsInTicks / lastTicks : 0, counts.pairTests
+    );
+    DrawText(line, x, y, FRAME_STATS_FONT_SIZE, WHITE);
+    y += lineHeight;
+
+    SampleSummary allocations = Summarize(allocationsPerFrame);
+    snprintf(
+      line, sizeof(line), "allocations/frame  last %ld (%ld B)  max %.0f",
+      lastAllocations, lastAllocationBytes, allocations.max
+    );
+    DrawText(line, x, y, FRAME_STATS_FONT_SIZE, WHITE);
+  }
+
+ private:
+  float sorted[FRAME_STATS_WINDOW];
+
+  SampleSummary Summarize(const RollingSamples& rolling) {
+    SampleSummary summary;
+    if (rolling.count == 0) {
+      return summary;
+    }
+    std::copy(rolling.samples, rolling.samples + rolling.count, sorted);
+    std::sort(sorted, sorted + rolling.count);
+    summary.p50 = sorted[(rolling.count - 1) / 2];
+    summary.p99 = sorted[(rolling.count - 1) * 99 / 100];
+    summary.max = sorted[rolling.count - 1];
+
+    for (int i = 0; i < rolling.count; ++i) {
+      int bucket = summary.max > 0
+                     ? (int)(sorted[i] / summary.max * FRAME_STATS_BUCKETS)
+                     : 0;
+      bucket = std::min(bucket, FRAME_STATS_BUCKETS - 1);
+      ++summary.buckets[bucket];
+      summary.tallest = std::max(summary.tallest, summary.buckets[bucket]);
+    }
+    return summary;
+  }
+
+  // One bar per bucket, 0 on the left and the max on the right
+  void DrawHistogram(
+    const SampleSummary& summary, int x, int y, int width, Color color
+  ) {
+    if (summary.tallest == 0) {
+      return;
+    }
+    int barWidth = width / FRAME_STATS_BUCKETS;
+    for (int i = 0; i < FRAME_STATS_BUCKETS; ++i) {
+      int height =
+        summary.buckets[i] * FRAME_STATS_GRAPH_HEIGHT / summary.tallest;
+      DrawRectangle(
+        x + i * barWidth, y + FRAME_STATS_GRAPH_HEIGHT - height, barWidth - 1,
+        height, color
+      );
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef HASH
+#define HASH
+
+#include <cstddef>
+#include <cstdint>
+
+// 64-bit FNV-1a. Not cryptographic, only meant for spotting changed data.
+const uint64_t HASH_SEED(14695981039346656037ULL);
+const uint64_t HASH_PRIME(1099511628211ULL);
+
+// Pass the result of one call as the seed of the next to hash data that
+// isn't in one piece
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed = HASH_SEED) {
+  const unsigned char* bytes = (const unsigned char*)data;
+  uint64_t hash = seed;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= HASH_PRIME;
+  }
+  return hash;
+}
+
+#endif
@@ -0,0 +1,180 @@
+#ifndef INPUT
+#define INPUT
+
+#include <raylib.h>
+
+#include <cmath>
+#include <vector>
+
+// A press up to this many seconds before it can be acted on still counts,
+// so jumping just before landing or swinging just before the cooldown ends
+// isn't lost
+const double JUMP_BUFFER_TIME(0.1);
+const double ATTACK_BUFFER_TIME(0.15);
+
+enum InputAction {
+  ACTION_LEFT,
+  ACTION_RIGHT,
+  ACTION_JUMP,
+  ACTION_ATTACK,
+  ACTION_COUNT,
+};
+
+const char* INPUT_ACTION_NAMES[] = {"left", "right", "jump", "attack"};
+
+// Most presses acted on in one frame that are kept for latency tracking
+const int INPUT_MAX_ACTED(16);
+
+struct InputBinding {
+  InputAction action;
+  int key;
+};
+
+const InputBinding INPUT_BINDINGS[] = {
+  {ACTION_LEFT, KEY_A},
+  {ACTION_RIGHT, KEY_D},
+  {ACTION_JUMP, KEY_SPACE},
+  {ACTION_ATTACK, KEY_J},
+};
+const int INPUT_BINDING_COUNT(4);
+
+struct InputEdge {
+  InputAction action;
+  bool pressed;  // or released
+  double time;   // GetTime() when it was polled
+};
+
+// A press that made something happen, see Consume
+struct ActedInput {
+  InputAction action;
+  double pressedAt;
+  double actedAt;  // GetTime() in the tick that consumed it
+};
+
+// Turns the keyboard into press and release edges with timestamps, and
+// hands them to the fixed ticks instead of the rendered frames. Every edge
+// reaches exactly one tick, in order, however many ticks a frame runs, and
+// a tap shorter than a frame still shows up as a press and a release.
+//
+// raylib only reports input once per frame, so every edge from one Poll
+// shares its timestamp.
+struct InputBuffer {
+  std::vector<InputEdge> pending;  // polled, not given to a tick yet
+  double polledAt = 0;
+  bool keyDown[INPUT_BINDING_COUNT] = {};  // as of the last Poll
+
+  // For the tick being simulated
+  double tickEnd = 0;
+  bool down[ACTION_COUNT] = {};
+  bool pressed[ACTION_COUNT] = {};
+  bool released[ACTION_COUNT] = {};
+  double lastPress[ACTION_COUNT] = {-INFINITY, -INFINITY, -INFINITY, -INFINITY};
+  std::vector<InputEdge> applied;  // the edges this tick took, for replays
+
+  // Consumed since the frame started, read by LatencyTracker
+  ActedInput acted[INPUT_MAX_ACTED];
+  int actedCount = 0;
+
+  // Once per frame, before the ticks run
+  void Poll() {
+    polledAt = GetTime();
+
+    int presses[INPUT_BINDING_COUNT] = {};
+    for (int key = GetKeyPressed(); key != 0; key = GetKeyPressed()) {
+      for (int i = 0; i < INPUT_BINDING_COUNT; ++i) {
+        presses[i] += INPUT_BINDINGS[i].key == key;
+      }
+    }
+
+    for (int i = 0; i < INPUT_BINDING_COUNT; ++i) {
+      InputAction action = INPUT_BINDINGS[i].action;
+      bool nowDown = IsKeyDown(INPUT_BINDINGS[i].key);
+      for (int press = 0; press < presses[i]; ++press) {
+        if (keyDown[i]) {
+          pending.push_back({action, false, polledAt});
+        }
+        pending.push_back({action, true, polledAt});
+        keyDown[i] = true;
+      }
+      if (keyDown[i] != nowDown) {
+        pending.push_back({action, nowDown, polledAt});
+        keyDown[i] = nowDown;
+      }
+    }
+  }
+
+  // Applies the edges up to this tick's end, which lies behind seconds
+  // before the Poll. The last tick of a frame passes 0 so nothing polled
+  // waits for the next frame.
+  void BeginTick(double behind) { BeginTickEndingAt(polledAt - behind); }
+
+  // The same for edges that were given with Feed instead of polled
+  void BeginTickEndingAt(double end) {
+    tickEnd = end;
+    applied.clear();
+    for (int a = 0; a < ACTION_COUNT; ++a) {
+      pressed[a] = false;
+      released[a] = false;
+    }
+
+    size_t used = 0;
+    while (used < pending.size() && pending[used].time <= tickEnd) {
+      const InputEdge& edge = pending[used];
+      down[edge.action] = edge.pressed;
+      if (edge.pressed) {
+        pressed[edge.action] = true;
+        lastPress[edge.action] = edge.time;
+      } else {
+        released[edge.action] = true;
+      }
+      applied.push_back(edge);
+      ++used;
+    }
+    pending.erase(pending.begin(), pending.begin() + used);
+  }
+
+  // Queues an edge as if it had been polled at time, for replays and
+  // scripted input. Edges have to be fed in the order they happened.
+  void Feed(InputAction action, bool pressed, double time) {
+    pending.push_back({action, pressed, time});
+  }
+
+  bool IsDown(InputAction action) const { return down[action]; }
+  bool WasPressed(InputAction action) const { return pressed[action]; }
+  bool WasReleased(InputAction action) const { return released[action]; }
+
+  // True once for a press no older than window at the end of this tick.
+  // Only call it when the action can happen, a press that isn't consumed
+  // stays buffered until the window runs out.
+  bool Consume(InputAction action, double window) {
+    if (lastPress[action] < tickEnd - window) {
+      return false;
+    }
+    if (actedCount < INPUT_MAX_ACTED) {
+      acted[actedCount++] = {action, lastPress[action], GetTime()};
+    }
+    lastPress[action] = -INFINITY;
+    return true;
+  }
+
+  // Forgets everything and takes the keys as they are now, call it while
+  // the game isn't running so keys used in the menus don't carry over
+  void Reset() {
+    pending.clear();
+    actedCount = 0;
+    for (int i = 0; i < INPUT_BINDING_COUNT; ++i) {
+      keyDown[i] = IsKeyDown(INPUT_BINDINGS[i].key);
+    }
+    for (int a = 0; a < ACTION_COUNT; ++a) {
+      down[a] = false;
+      pressed[a] = false;
+      released[a] = false;
+      lastPress[a] = -INFINITY;
+    }
+    for (int i = 0; i < INPUT_BINDING_COUNT; ++i) {
+      down[INPUT_BINDINGS[i].action] |= keyDown[i];
+    }
+  }
+};
+
+#endif
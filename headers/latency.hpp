@@ -0,0 +1,137 @@
+#ifndef LATENCY
+#define LATENCY
+
+#include <raylib.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "input.hpp"
+
+const char* LATENCY_FILENAME("latency.txt");
+// Histograms count latencies in buckets this wide, anything past the last
+// one lands in it
+const double LATENCY_BUCKET_MS(0.25);
+const int LATENCY_BUCKETS(400);
+const int LATENCY_OVERLAY_FONT_SIZE(20);
+
+struct LatencyHistogram {
+  int buckets[LATENCY_BUCKETS] = {};
+  int count = 0;
+  double maxMs = 0;
+
+  void Add(double ms) {
+    int bucket = ms > 0 ? (int)(ms / LATENCY_BUCKET_MS) : 0;
+    if (bucket >= LATENCY_BUCKETS) {
+      bucket = LATENCY_BUCKETS - 1;
+    }
+    ++buckets[bucket];
+    ++count;
+    if (ms > maxMs) {
+      maxMs = ms;
+    }
+  }
+
+  // Upper edge of the bucket the fraction p of samples falls under
+  double Percentile(double p) const {
+    int needed = (int)(p * count + 0.999);
+    int seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS - 1; ++i) {
+      seen += buckets[i];
+      if (seen >= needed) {
+        return (i + 1) * LATENCY_BUCKET_MS;
+      }
+    }
+    return maxMs;
+  }
+};
+
+// Follows every press that made something happen, from the Poll that saw
+// it, through the tick that consumed it, to the frame that first draws the
+// result. Call FrameDrawn right before EndDrawing, everything a frame's
+// ticks did is drawn by that frame.
+//
+// The end point is when the frame is handed to raylib, the buffer swap and
+// the display add a little more that can't be seen from here.
+struct LatencyTracker {
+  LatencyHistogram total[ACTION_COUNT];  // press to the frame drawing it
+  LatencyHistogram toTick[ACTION_COUNT];  // the part spent waiting for a tick
+  bool showOverlay = false;
+
+  void FrameDrawn(InputBuffer& input) {
+    double now = GetTime();
+    for (int i = 0; i < input.actedCount; ++i) {
+      const ActedInput& acted = input.acted[i];
+      total[acted.action].Add((now - acted.pressedAt) * 1000);
+      toTick[acted.action].Add((acted.actedAt - acted.pressedAt) * 1000);
+    }
+    input.actedCount = 0;
+  }
+
+  void Draw(int x, int y) const {
+    char line[128];
+    DrawText("INPUT LATENCY (ms)", x, y, LATENCY_OVERLAY_FONT_SIZE, RED);
+    for (int a = 0; a < ACTION_COUNT; ++a) {
+      if (total[a].count == 0) {
+        continue;
+      }
+      y += LATENCY_OVERLAY_FONT_SIZE + 4;
+      snprintf(
+        line, sizeof(line), "%-6s n=%-4d p50 %5.1f  p95 %5.1f  p99 %5.1f",
+        INPUT_ACTION_NAMES[a], total[a].count, total[a].Percentile(0.5),
+        total[a].Percentile(0.95), total[a].Percentile(0.99)
+      );
+      DrawText(line, x, y, LATENCY_OVERLAY_FONT_SIZE, RED);
+    }
+  }
+
+  // Percentiles per action, then the non-empty buckets as
+  // "action part bucket_start_ms count" lines for plotting
+  bool Export(const char filename[]) const {
+    std::ofstream file(filename);
+    if (!file) {
+      std::cerr << "Unable to write " << filename << std::endl;
+      return false;
+    }
+    file << "# action part samples p50_ms p95_ms p99_ms max_ms\n";
+    for (int a = 0; a < ACTION_COUNT; ++a) {
+      WriteSummary(file, INPUT_ACTION_NAMES[a], "total", total[a]);
+      WriteSummary(file, INPUT_ACTION_NAMES[a], "to_tick", toTick[a]);
+    }
+    file << "# action part bucket_start_ms count\n";
+    for (int a = 0; a < ACTION_COUNT; ++a) {
+      WriteBuckets(file, INPUT_ACTION_NAMES[a], "total", total[a]);
+      WriteBuckets(file, INPUT_ACTION_NAMES[a], "to_tick", toTick[a]);
+    }
+    return true;
+  }
+
+ private:
+  static void WriteSummary(
+    std::ofstream& file, const char action[], const char part[],
+    const LatencyHistogram& histogram
+  ) {
+    if (histogram.count == 0) {
+      return;
+    }
+    file << action << " " << part << " " << histogram.count << " "
+         << histogram.Percentile(0.5) << " " << histogram.Percentile(0.95)
+         << " " << histogram.Percentile(0.99) << " " << histogram.maxMs
+         << "\n";
+  }
+
+  static void WriteBuckets(
+    std::ofstream& file, const char action[], const char part[],
+    const LatencyHistogram& histogram
+  ) {
+    for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+      if (histogram.buckets[i] > 0) {
+        file << action << " " << part << " " << i * LATENCY_BUCKET_MS << " "
+             << histogram.buckets[i] << "\n";
+      }
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,189 @@
+#ifndef LEADERBOARD
+#define LEADERBOARD
+
+#include <condition_variable>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "scorestore.hpp"
+
+// Before the score store, the top ten lived in this text file. It is
+// imported once when the store is still empty.
+const char* HIGH_SCORES_FILENAME("high_scores.txt");
+const int LEADERBOARD_SIZE(10);
+
+struct ScoreEntry {
+  int score;
+  std::string name;
+};
+
+// The top of the score store, kept sorted in memory for the score screens.
+// Inserting only moves the rows below the new one, and the run is written
+// to the store on a background thread so the UI never waits on the disk.
+struct Leaderboard {
+  std::vector<ScoreEntry> entries;  // best first
+  int firstChangedRow = -1;         // since the last TakeChangedRow
+
+  ScoreStore store;
+  std::mutex storeMutex;  // held by the writer while it appends or compacts
+
+  std::thread writer;
+  std::mutex saveMutex;
+  std::condition_variable saveReady;
+  std::vector<ScoreEntry> pendingSaves;
+  bool stopping = false;
+
+  ~Leaderboard() { Stop(); }
+
+  void Load(const char logFilename[], const char indexFilename[]) {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    if (!store.Open(logFilename, indexFilename)) {
+      std::cerr << "Unable to open the score store, scores won't be saved"
+                << std::endl;
+    } else if (store.Count() == 0) {
+      ImportHighScores(HIGH_SCORES_FILENAME);
+    }
+
+    entries.clear();
+    for (const ScoreRecord& record : store.TopK(LEADERBOARD_SIZE)) {
+      entries.push_back({record.score, record.name});
+    }
+    firstChangedRow = 0;
+  }
+
+  // Returns the row the score landed on, or -1 if it didn't make the table.
+  // Ties go below the scores already there. The run is stored either way.
+  int Insert(int score, const std::string& name) {
+    QueueSave({score, name});
+
+    size_t row = 0;
+    while (row < entries.size() && entries[row].score >= score) {
+      ++row;
+    }
+    if ((int)row >= LEADERBOARD_SIZE) {
+      return -1;
+    }
+
+    entries.insert(entries.begin() + row, {score, name});
+    if ((int)entries.size() > LEADERBOARD_SIZE) {
+      entries.pop_back();
+    }
+    if (firstChangedRow < 0 || (int)row < firstChangedRow) {
+      firstChangedRow = row;
+    }
+    return row;
+  }
+
+  // First row that differs from what the UI last showed, or -1
+  int TakeChangedRow() {
+    int row = firstChangedRow;
+    firstChangedRow = -1;
+    return row;
+  }
+
+  // Queries over every stored run. Runs still waiting for the writer
+  // aren't counted yet, and a compaction holds these up until it is done.
+  std::vector<ScoreEntry> Top(size_t count) {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    return ToEntries(store.TopK(count));
+  }
+
+  size_t RankOf(int score) {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    return store.RankOf(score);
+  }
+
+  std::vector<ScoreEntry> ScoresOf(const std::string& name) {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    return ToEntries(store.ScoresOf(name));
+  }
+
+  // Writes anything still queued and stops the writer
+  void Stop() {
+    if (writer.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(saveMutex);
+        stopping = true;
+      }
+      saveReady.notify_all();
+      writer.join();
+    }
+    std::lock_guard<std::mutex> lock(storeMutex);
+    store.Close();
+  }
+
+ private:
+  static std::vector<ScoreEntry> ToEntries(
+    const std::vector<ScoreRecord>& records
+  ) {
+    std::vector<ScoreEntry> result;
+    for (const ScoreRecord& record : records) {
+      result.push_back({record.score, record.name});
+    }
+    return result;
+  }
+
+  // One "score name" line per entry, best first
+  void ImportHighScores(const char scoresFilename[]) {
+    std::ifstream scoresFile(scoresFilename);
+    std::string line;
+    ScoreRecord record;
+    while (getline(scoresFile, line)) {
+      size_t end = line.find(" ");
+      if (end == std::string::npos) {
+        continue;
+      }
+      try {
+        int score = std::stoi(line.substr(0, end));
+        store.Append(score, line.substr(end + 1), record);
+      } catch (const std::exception&) {
+        std::cerr << "Skipping bad high score line: " << line << std::endl;
+      }
+    }
+  }
+
+  void QueueSave(const ScoreEntry& entry) {
+    if (!writer.joinable()) {
+      stopping = false;
+      writer = std::thread(&Leaderboard::WriterLoop, this);
+    }
+    {
+      std::lock_guard<std::mutex> lock(saveMutex);
+      pendingSaves.push_back(entry);
+    }
+    saveReady.notify_one();
+  }
+
+  void WriterLoop() {
+    std::vector<ScoreEntry> saving;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(saveMutex);
+        saveReady.wait(lock, [this] {
+          return stopping || !pendingSaves.empty();
+        });
+        if (pendingSaves.empty()) {
+          return;
+        }
+        saving.swap(pendingSaves);
+      }
+
+      std::lock_guard<std::mutex> lock(storeMutex);
+      ScoreRecord record;
+      for (const ScoreEntry& entry : saving) {
+        store.Append(entry.score, entry.name, record);
+      }
+      saving.clear();
+      if (store.NeedsCompaction()) {
+        store.Compact();
+      }
+    }
+  }
+};
+
+#endif
@@ -17,6 +17,9 @@ struct Level {
   std::vector<Vector2> itemSpawns;
   std::vector<Item*> items;
 
+  // Binomial coefficients for the moving obstacles' curves
+  std::vector<std::vector<int>> pascalsTriangle = BASE_PASCALS_TRIANGLE;
+
   void Update(Rectangle limits, const float timestep) {
     for (Obstacle* o : obstacles) {
       if (o->type == ObstacleType::MOVING) {
@@ -28,19 +31,10 @@ struct Level {
 		}
   }
 
-  void Draw() {
-    for (Obstacle* o : obstacles) {
-      o->Draw();
-    }
-		for (Bullet* b : bullets) {
-			b->Draw();
-		}
-  }
-
   void GeneratePaths() {
     for (Obstacle* o : obstacles) {
       if (o->type == ObstacleType::MOVING) {
-        o->path.CalculateCurve();
+        o->path.CalculateCurve(pascalsTriangle);
       }
     }
   }
@@ -123,7 +117,8 @@ struct Level {
     }
 
     if (highestControlPointCount > 0) {
-      pascalsTriangle = GeneratePascalsTriangle(highestControlPointCount);
+      level->pascalsTriangle =
+        GeneratePascalsTriangle(highestControlPointCount);
     }
 
     int itemSpawnCount;
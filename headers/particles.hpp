@@ -0,0 +1,164 @@
+#ifndef PARTICLES
+#define PARTICLES
+
+#include <raylib.h>
+#include <rlgl.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Room for well over 100k at once. A multiple of PARTICLE_LANES.
+const int PARTICLE_CAPACITY(1 << 17);
+// Particles are integrated this many at a time, as one GCC vector, so the
+// integrator is SIMD whatever the optimization flags. The few slots past
+// the live ones that get integrated along are never drawn.
+const int PARTICLE_LANES(4);
+typedef float ParticleLanes
+  __attribute__((vector_size(PARTICLE_LANES * sizeof(float))));
+
+const float PARTICLE_GRAVITY(900);  // units per second squared
+const float PARTICLE_SIZE(3);
+const float PARTICLE_FADE_TIME(0.3f);  // seconds of fading out at the end
+
+// Blood, picked per particle by colorIndex
+const Color PARTICLE_PALETTE[] = {
+  {200, 16, 16, 255},
+  {160, 8, 8, 255},
+  {120, 0, 0, 255},
+  {230, 40, 30, 255},
+};
+const int PARTICLE_PALETTE_SIZE(4);
+
+// Hit and death effects. Every particle lives in one set of fixed size
+// arrays, one per field, with the live ones packed at the front, so
+// emitting and dying never allocate and updating streams through memory.
+// They don't collide with anything, they just fly, fall and fade.
+struct ParticleSystem {
+  std::vector<float> x, y, vx, vy, life;
+  std::vector<unsigned char> colorIndex;
+  int count = 0;
+  int dropped = 0;    // not emitted because every slot was taken
+  uint32_t seed = 1;  // own generator, so effects don't use up rand()
+
+  ParticleSystem() {
+    x.resize(PARTICLE_CAPACITY);
+    y.resize(PARTICLE_CAPACITY);
+    vx.resize(PARTICLE_CAPACITY);
+    vy.resize(PARTICLE_CAPACITY);
+    life.resize(PARTICLE_CAPACITY);
+    colorIndex.resize(PARTICLE_CAPACITY);
+  }
+
+  // Sprays amount particles out of a point, mostly upwards. speed is the
+  // fastest one in units per second and lifetime the longest in seconds.
+  void Burst(Vector2 at, int amount, float speed, float lifetime) {
+    for (int i = 0; i < amount; ++i) {
+      if (count == PARTICLE_CAPACITY) {
+        dropped += amount - i;
+        return;
+      }
+      float angle = Random() * 2 * PI;
+      float launch = speed * (0.3f + 0.7f * Random());
+      x[count] = at.x;
+      y[count] = at.y;
+      vx[count] = cosf(angle) * launch;
+      vy[count] = sinf(angle) * launch - speed * 0.5f;
+      life[count] = lifetime * (0.5f + 0.5f * Random());
+      colorIndex[count] = NextRandom() % PARTICLE_PALETTE_SIZE;
+      ++count;
+    }
+  }
+
+  void Update(float dt) {
+    float fall = PARTICLE_GRAVITY * dt;
+    for (int i = 0; i < count; i += PARTICLE_LANES) {
+      ParticleLanes laneVx = Load(&vx[i]);
+      ParticleLanes laneVy = Load(&vy[i]) + fall;
+      Store(&vy[i], laneVy);
+      Store(&x[i], Load(&x[i]) + laneVx * dt);
+      Store(&y[i], Load(&y[i]) + laneVy * dt);
+      Store(&life[i], Load(&life[i]) - dt);
+    }
+
+    // Only a few die on any one tick, the last live one fills each gap
+    int i = 0;
+    while (i < count) {
+      if (life[i] > 0) {
+        ++i;
+        continue;
+      }
+      --count;
+      x[i] = x[count];
+      y[i] = y[count];
+      vx[i] = vx[count];
+      vy[i] = vy[count];
+      life[i] = life[count];
+      colorIndex[i] = colorIndex[count];
+    }
+  }
+
+  // Every particle inside view as quads in one run of raylib's batch,
+  // which only breaks it up when its vertex buffer fills. Call between
+  // BeginMode2D and EndMode2D.
+  void Draw(Rectangle view) {
+    if (count == 0) {
+      return;
+    }
+    float right = view.x + view.width;
+    float bottom = view.y + view.height;
+
+    rlSetTexture(rlGetTextureIdDefault());
+    rlBegin(RL_QUADS);
+    for (int i = 0; i < count; ++i) {
+      float left = x[i];
+      float top = y[i];
+      if (left > right || top > bottom || left + PARTICLE_SIZE < view.x ||
+          top + PARTICLE_SIZE < view.y) {
+        continue;
+      }
+      rlCheckRenderBatchLimit(4);
+
+      Color color = PARTICLE_PALETTE[colorIndex[i]];
+      if (life[i] < PARTICLE_FADE_TIME) {
+        color.a = (unsigned char)(color.a * life[i] / PARTICLE_FADE_TIME);
+      }
+      rlColor4ub(color.r, color.g, color.b, color.a);
+      rlVertex2f(left, top);
+      rlVertex2f(left, top + PARTICLE_SIZE);
+      rlVertex2f(left + PARTICLE_SIZE, top + PARTICLE_SIZE);
+      rlVertex2f(left + PARTICLE_SIZE, top);
+    }
+    rlEnd();
+    rlSetTexture(0);
+  }
+
+  void Clear() { count = 0; }
+
+ private:
+  // memcpy as the arrays don't promise vector alignment, it still
+  // compiles to a single load
+  static ParticleLanes Load(const float* from) {
+    ParticleLanes lanes;
+    memcpy(&lanes, from, sizeof(lanes));
+    return lanes;
+  }
+
+  static void Store(float* to, ParticleLanes lanes) {
+    memcpy(to, &lanes, sizeof(lanes));
+  }
+
+  // xorshift32
+  uint32_t NextRandom() {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+  }
+
+  // In [0, 1)
+  float Random() { return (NextRandom() >> 8) * (1.0f / 16777216.0f); }
+};
+
+#endif
@@ -5,6 +5,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <string>
 
 struct Properties {
   float hAccel;  // per-second
@@ -29,6 +30,46 @@ struct Properties {
   float camDrift;  // per-frame
 };
 
+// Sets a property by its name in the properties file, converted the same
+// way. False for a name it doesn't know, CAM_EDGES included.
+bool SetProperty(
+  Properties* properties, const std::string& name, float propertyValue,
+  const int targetFps
+) {
+  if (name == "H_ACCEL") {
+    properties->hAccel = propertyValue;
+  } else if (name == "H_COEFF") {
+    properties->hCoeff = propertyValue;
+  } else if (name == "H_OPPOSITE") {
+    properties->hOpposite = propertyValue;
+  } else if (name == "H_AIR") {
+    properties->hAir = propertyValue;
+  } else if (name == "MIN_H_VEL") {
+    properties->hVelMin = propertyValue;
+  } else if (name == "MAX_H_VEL") {
+    properties->hVelMax = propertyValue / targetFps;
+  } else if (name == "GRAVITY") {
+    properties->gravity = propertyValue / targetFps;
+  } else if (name == "V_ACCEL") {
+    properties->vAccel = propertyValue / targetFps;
+  } else if (name == "V_HOLD") {
+    properties->vHold = propertyValue;
+  } else if (name == "V_SAFE") {
+    properties->vSafe = propertyValue;
+  } else if (name == "CUT_V_VEL") {
+    properties->vVelCut = propertyValue / targetFps;
+  } else if (name == "MAX_V_VEL") {
+    properties->vVelMax = propertyValue / targetFps;
+  } else if (name == "GAP") {
+    properties->gap = propertyValue;
+  } else if (name == "CAM_DRIFT") {
+    properties->camDrift = propertyValue / targetFps;
+  } else {
+    return false;
+  }
+  return true;
+}
+
 Properties* LoadProperties(const char filename[], const int targetFps) {
   std::ifstream propertiesFile(filename);
 	Properties* properties = new Properties;
@@ -64,35 +105,7 @@ Properties* LoadProperties(const char filename[], const int targetFps) {
     
     float propertyValue = stof(input.substr(splitter, input.length()));
 
-    if (inputProperty == "H_ACCEL") {
-      properties->hAccel = propertyValue;
-    } else if (inputProperty == "H_COEFF") {
-      properties->hCoeff = propertyValue;
-    } else if (inputProperty == "H_OPPOSITE") {
-      properties->hOpposite = propertyValue;
-    } else if (inputProperty == "H_AIR") {
-      properties->hAir = propertyValue;
-    } else if (inputProperty == "MIN_H_VEL") {
-      properties->hVelMin = propertyValue;
-    } else if (inputProperty == "MAX_H_VEL") {
-      properties->hVelMax = propertyValue / targetFps;
-    } else if (inputProperty == "GRAVITY") {
-      properties->gravity = propertyValue / targetFps;
-    } else if (inputProperty == "V_ACCEL") {
-      properties->vAccel = propertyValue / targetFps;
-    } else if (inputProperty == "V_HOLD") {
-      properties->vHold = propertyValue;
-    } else if (inputProperty == "V_SAFE") {
-      properties->vSafe = propertyValue;
-    } else if (inputProperty == "CUT_V_VEL") {
-      properties->vVelCut = propertyValue / targetFps;
-    } else if (inputProperty == "MAX_V_VEL") {
-      properties->vVelMax = propertyValue / targetFps;
-    } else if (inputProperty == "GAP") {
-      properties->gap = propertyValue;
-    } else if (inputProperty == "CAM_DRIFT") {
-      properties->camDrift = propertyValue / targetFps;
-    }
+    SetProperty(properties, inputProperty, propertyValue, targetFps);
   }
 
   propertiesFile.close();
@@ -0,0 +1,23 @@
+#ifndef RANDOM
+#define RANDOM
+
+#include <cstdint>
+
+// xorshift32. The simulation draws from these instead of rand(), whose
+// state can't be read back, so a saved world carries its randomness along
+// and makes the same choices again after being restored.
+struct GameRandom {
+  uint32_t state = 2463534242u;  // never 0, xorshift would stay there
+
+  uint32_t Next() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+
+  // In [0, n)
+  int Below(int n) { return (int)(Next() % (uint32_t)n); }
+};
+
+#endif
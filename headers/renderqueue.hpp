@@ -0,0 +1,199 @@
+#ifndef RENDER_QUEUE
+#define RENDER_QUEUE
+
+#include <raylib.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// Draw order, back to front. Within a layer commands are grouped by
+// texture, so anything that has to overlap in a fixed order needs its own
+// layer.
+enum RenderLayer {
+  // World space
+  LAYER_FLOOR = 0,
+  LAYER_LEVEL,
+  LAYER_PROJECTILES,
+  LAYER_RANGED_ENEMIES,
+  LAYER_PLAYER,
+  LAYER_WEAPON,
+  LAYER_MELEE_ENEMIES,  // over the knight and the sword, as they always were
+  LAYER_ITEMS,
+  LAYER_ITEM_ICONS,
+  LAYER_DEBUG,
+
+  // Screen space
+  LAYER_UI_BACKGROUND,
+  LAYER_UI_PANELS,
+  LAYER_UI_SPRITES,
+  LAYER_UI_TEXT,
+};
+
+enum RenderCommandType {
+  SPRITE_COMMAND,
+  RECTANGLE_COMMAND,
+  CIRCLE_COMMAND,
+  TEXT_COMMAND,
+};
+
+struct RenderCommand {
+  RenderCommandType type;
+  int layer;
+  unsigned int textureKey;
+  unsigned int sequence;  // submission order, breaks ties when sorting
+
+  Texture texture;
+  Rectangle source;
+  Rectangle dest;  // circles keep their center in x, y and radius in width
+  Vector2 origin;
+  float rotation;
+  Color tint;
+
+  size_t textOffset;  // into RenderQueue::textArena
+  int fontSize;
+};
+
+struct RenderStats {
+  int commands = 0;
+  int batches = 0;  // runs of consecutive commands sharing a texture
+};
+
+// Collects draw calls for a frame, then sorts them by layer and texture so
+// raylib can merge consecutive draws into as few batches as possible.
+// Nothing here touches the GPU until Flush, so a filled and sorted queue
+// can be inspected without a window.
+struct RenderQueue {
+  std::vector<RenderCommand> commands;
+  std::vector<char> textArena;
+  RenderStats lastFlushStats;
+
+  void Clear() {
+    commands.clear();
+    textArena.clear();
+  }
+
+  void Sprite(
+    int layer, Texture texture, Rectangle source, Rectangle dest,
+    Vector2 origin = {0, 0}, float rotation = 0, Color tint = WHITE
+  ) {
+    RenderCommand& c = Push(SPRITE_COMMAND, layer, texture.id);
+    c.texture = texture;
+    c.source = source;
+    c.dest = dest;
+    c.origin = origin;
+    c.rotation = rotation;
+    c.tint = tint;
+  }
+
+  // Same as DrawTextureRec, a negative source width or height flips it
+  void SpriteAt(
+    int layer, Texture texture, Rectangle source, Vector2 position,
+    Color tint = WHITE
+  ) {
+    Sprite(
+      layer, texture, source,
+      {position.x, position.y, fabsf(source.width), fabsf(source.height)},
+      {0, 0}, 0, tint
+    );
+  }
+
+  void Rect(int layer, Rectangle rec, Color color) {
+    RenderCommand& c = Push(RECTANGLE_COMMAND, layer, ShapesTextureKey());
+    c.dest = rec;
+    c.tint = color;
+  }
+
+  void Circle(int layer, Vector2 center, float radius, Color color) {
+    RenderCommand& c = Push(CIRCLE_COMMAND, layer, ShapesTextureKey());
+    c.dest = {center.x, center.y, radius, radius};
+    c.tint = color;
+  }
+
+  // The text is copied, the caller's string doesn't need to outlive the
+  // frame
+  void Text(
+    int layer, const char* text, int posX, int posY, int fontSize, Color color
+  ) {
+    RenderCommand& c =
+      Push(TEXT_COMMAND, layer, GetFontDefault().texture.id);
+    c.dest = {(float)posX, (float)posY, 0, 0};
+    c.fontSize = fontSize;
+    c.tint = color;
+    c.textOffset = textArena.size();
+    textArena.insert(textArena.end(), text, text + strlen(text) + 1);
+  }
+
+  const char* GetText(const RenderCommand& c) const {
+    return &textArena[c.textOffset];
+  }
+
+  void Sort() {
+    std::sort(
+      commands.begin(), commands.end(),
+      [](const RenderCommand& a, const RenderCommand& b) {
+        if (a.layer != b.layer) return a.layer < b.layer;
+        if (a.textureKey != b.textureKey) return a.textureKey < b.textureKey;
+        return a.sequence < b.sequence;
+      }
+    );
+  }
+
+  // Counts batches in the current command order, call Sort first to see
+  // what Flush would submit
+  RenderStats GetStats() const {
+    RenderStats stats;
+    stats.commands = commands.size();
+    for (size_t i = 0; i < commands.size(); ++i) {
+      if (i == 0 || commands[i].textureKey != commands[i - 1].textureKey) {
+        ++stats.batches;
+      }
+    }
+    return stats;
+  }
+
+  void Flush() {
+    Sort();
+    lastFlushStats = GetStats();
+
+    for (const RenderCommand& c : commands) {
+      switch (c.type) {
+        case SPRITE_COMMAND:
+          DrawTexturePro(
+            c.texture, c.source, c.dest, c.origin, c.rotation, c.tint
+          );
+          break;
+        case RECTANGLE_COMMAND:
+          DrawRectangleRec(c.dest, c.tint);
+          break;
+        case CIRCLE_COMMAND:
+          DrawCircleV({c.dest.x, c.dest.y}, c.dest.width, c.tint);
+          break;
+        case TEXT_COMMAND:
+          DrawText(GetText(c), c.dest.x, c.dest.y, c.fontSize, c.tint);
+          break;
+      }
+    }
+
+    Clear();
+  }
+
+ private:
+  // Shapes are drawn with raylib's shapes texture. Once the window is open
+  // that is the default font's texture, so shapes and default-font text
+  // batch together the way raylib draws them.
+  static unsigned int ShapesTextureKey() { return GetShapesTexture().id; }
+
+  RenderCommand& Push(RenderCommandType type, int layer, unsigned int key) {
+    RenderCommand c;
+    c.type = type;
+    c.layer = layer;
+    c.textureKey = key;
+    c.sequence = commands.size();
+    commands.push_back(c);
+    return commands.back();
+  }
+};
+
+#endif
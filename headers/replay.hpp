@@ -0,0 +1,394 @@
+#ifndef REPLAY
+#define REPLAY
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "input.hpp"
+#include "random.hpp"
+#include "savegame.hpp"
+#include "snapshot.hpp"
+#include "world.hpp"
+
+// A replay is the world as it was when recording started, followed by the
+// input edges every tick took and when that tick ended. That is all Tick
+// depends on, so playing one back goes through exactly the same states.
+const char* REPLAY_FILENAME("replay.bin");
+const char REPLAY_MAGIC[4] = {'H', 'K', 'R', 'P'};
+const uint16_t REPLAY_VERSION(1);
+
+// Followed by startSize bytes of the starting world, in the save file
+// format, then the ticks
+struct ReplayHeader {
+  char magic[4];
+  uint16_t version;
+  uint16_t reserved;
+  uint32_t startSize;
+  uint8_t down[ACTION_COUNT];  // what InputBuffer carried into the first tick
+  double lastPress[ACTION_COUNT];
+};
+
+// Followed by edges ReplayEdges
+struct ReplayTick {
+  double tickEnd;
+  uint32_t edges;
+  uint32_t reserved;
+};
+
+struct ReplayEdge {
+  double time;
+  uint8_t action;
+  uint8_t pressed;
+  uint8_t reserved[6];
+};
+
+// Streams a replay to a file as the ticks run
+struct ReplayWriter {
+  FILE* file = nullptr;
+  std::vector<unsigned char> startBytes;
+
+  ~ReplayWriter() { Close(); }
+
+  // Starts the file over from start, call it between ticks
+  bool Open(
+    const char filename[], const WorldSnapshot& start, uint64_t levelHash,
+    const InputBuffer& input
+  ) {
+    Close();
+    file = fopen(filename, "wb");
+    if (file == nullptr) {
+      std::cerr << "Unable to write " << filename << std::endl;
+      return false;
+    }
+    EncodeSave(start, levelHash, startBytes);
+
+    ReplayHeader header;
+    memset(&header, 0, sizeof(ReplayHeader));
+    memcpy(header.magic, REPLAY_MAGIC, 4);
+    header.version = REPLAY_VERSION;
+    header.startSize = startBytes.size();
+    for (int a = 0; a < ACTION_COUNT; ++a) {
+      header.down[a] = input.down[a];
+      header.lastPress[a] = input.lastPress[a];
+    }
+    fwrite(&header, sizeof(ReplayHeader), 1, file);
+    fwrite(startBytes.data(), 1, startBytes.size(), file);
+    return true;
+  }
+
+  // After InputBuffer::BeginTick
+  void Tick(const InputBuffer& input) {
+    if (file == nullptr) {
+      return;
+    }
+    ReplayTick tick = {input.tickEnd, (uint32_t)input.applied.size(), 0};
+    fwrite(&tick, sizeof(ReplayTick), 1, file);
+    for (const InputEdge& edge : input.applied) {
+      ReplayEdge record = {
+        edge.time, (uint8_t)edge.action, (uint8_t)edge.pressed, {}
+      };
+      fwrite(&record, sizeof(ReplayEdge), 1, file);
+    }
+  }
+
+  void Close() {
+    if (file != nullptr) {
+      fclose(file);
+      file = nullptr;
+    }
+  }
+};
+
+struct Replay {
+  WorldSnapshot start;
+  bool down[ACTION_COUNT] = {};
+  double lastPress[ACTION_COUNT] = {};
+  std::vector<double> tickEnds;
+  std::vector<size_t> firstEdges;  // per tick, plus one past the last
+  std::vector<InputEdge> edges;
+
+  // False for anything damaged, from another version or another level
+  bool Load(const char filename[], uint64_t levelHash) {
+    std::vector<unsigned char> bytes;
+    if (!ReadSaveFile(filename, bytes)) {
+      return false;
+    }
+    ReplayHeader header;
+    if (bytes.size() < sizeof(ReplayHeader)) {
+      std::cerr << "Replay is too short" << std::endl;
+      return false;
+    }
+    memcpy(&header, bytes.data(), sizeof(ReplayHeader));
+    if (memcmp(header.magic, REPLAY_MAGIC, 4) != 0 ||
+        header.version != REPLAY_VERSION) {
+      std::cerr << filename << " isn't a replay of this version" << std::endl;
+      return false;
+    }
+    size_t at = sizeof(ReplayHeader);
+    if (bytes.size() - at < header.startSize) {
+      std::cerr << "Replay is cut short" << std::endl;
+      return false;
+    }
+    std::vector<unsigned char> startBytes(
+      bytes.begin() + at, bytes.begin() + at + header.startSize
+    );
+    if (!DecodeSave(startBytes, levelHash, start)) {
+      return false;
+    }
+    at += header.startSize;
+    for (int a = 0; a < ACTION_COUNT; ++a) {
+      down[a] = header.down[a];
+      lastPress[a] = header.lastPress[a];
+    }
+
+    tickEnds.clear();
+    firstEdges.clear();
+    edges.clear();
+    // A tick cut short by a crash is dropped
+    while (bytes.size() - at >= sizeof(ReplayTick)) {
+      ReplayTick tick;
+      memcpy(&tick, &bytes[at], sizeof(ReplayTick));
+      at += sizeof(ReplayTick);
+      if ((bytes.size() - at) / sizeof(ReplayEdge) < tick.edges) {
+        break;
+      }
+      tickEnds.push_back(tick.tickEnd);
+      firstEdges.push_back(edges.size());
+      for (uint32_t i = 0; i < tick.edges; ++i) {
+        ReplayEdge edge;
+        memcpy(&edge, &bytes[at], sizeof(ReplayEdge));
+        at += sizeof(ReplayEdge);
+        edges.push_back(
+          {(InputAction)edge.action, edge.pressed != 0, edge.time}
+        );
+      }
+    }
+    firstEdges.push_back(edges.size());
+    return true;
+  }
+
+  size_t Ticks() const { return tickEnds.size(); }
+
+  // Puts the world and its input back to where the recording started
+  bool Begin(World& world) const {
+    if (!world.Restore(start)) {
+      return false;
+    }
+    InputBuffer& input = world.input;
+    input.pending.clear();
+    for (int a = 0; a < ACTION_COUNT; ++a) {
+      input.down[a] = down[a];
+      input.pressed[a] = false;
+      input.released[a] = false;
+      input.lastPress[a] = lastPress[a];
+    }
+    return true;
+  }
+
+  // Gives input what the tick took when it was recorded, in place of
+  // InputBuffer::BeginTick
+  void BeginTick(size_t tick, InputBuffer& input) const {
+    for (size_t i = firstEdges[tick]; i < firstEdges[tick + 1]; ++i) {
+      input.Feed(edges[i].action, edges[i].pressed, edges[i].time);
+    }
+    input.BeginTickEndingAt(tickEnds[tick]);
+  }
+};
+
+// Input for running without anyone playing, a rough stand-in for a player
+// so tuning shows in how long runs last. Swings at whatever is in reach,
+// turning to face it, closes in on enemies nearby while it can swing and
+// backs off while it can't, dodges bullets coming its way and heads for
+// the item when hurt. Otherwise runs one way or the other for a while and
+// jumps at random. The same seed always gives the same input.
+const int SCRIPT_MIN_RUN_TICKS(20);
+const int SCRIPT_MAX_RUN_TICKS(120);
+const int SCRIPT_JUMP_CHANCE(40);  // one in this many ticks
+const int SCRIPT_MAX_JUMP_TICKS(20);  // held for up to this long
+// From the player's center, where a swing lands
+const float SCRIPT_REACH_AHEAD(100);
+const float SCRIPT_REACH_BOTH_SIDES(5);  // this close it lands either way
+const float SCRIPT_REACH_HEIGHT(75);
+const float SCRIPT_BULLET_WARNING(120);  // dodges when one is this close
+const int SCRIPT_HEAL_BELOW(5);          // health
+const float SCRIPT_CHASE_DISTANCE(250);
+
+struct InputScript {
+  GameRandom random;
+  int runTicks = 0;
+  int jumpTicks = 0;
+  int running = 0;  // -1 left, 1 right
+  bool down[ACTION_COUNT] = {};
+
+  explicit InputScript(uint32_t seed) {
+    random.state = seed != 0 ? seed : WORLD_SEED;
+  }
+
+  // Looks at the world as the last tick left it, like a player looking at
+  // the last frame. In place of InputBuffer::BeginTick.
+  void BeginTick(World& world, double tickEnd) {
+    InputBuffer& input = world.input;
+    const Player* player = world.player;
+
+    int direction = Wander();
+    // Closes in on an enemy when it can swing, backs off while it can't
+    const Character* enemy = NearestEnemy(world);
+    if (enemy != nullptr) {
+      int toward = enemy->position.x < player->position.x ? -1 : 1;
+      direction = world.canSwing ? toward : -toward;
+    }
+    if (player->health < SCRIPT_HEAL_BELOW && !world.level->items.empty()) {
+      direction =
+        world.level->items[0]->position.x < player->position.x ? -1 : 1;
+    }
+    // Jumps over bullets flying flat, runs out from under steep ones
+    const Bullet* bullet = NearestComing(world);
+    bool dodgeJump = false;
+    if (bullet != nullptr) {
+      if (fabsf(bullet->direction.x) > fabsf(bullet->direction.y)) {
+        dodgeJump = true;
+      } else {
+        direction = bullet->position.x < player->position.x ? 1 : -1;
+      }
+    }
+
+    // Swings are taps
+    Set(input, ACTION_ATTACK, false, tickEnd);
+    int target = world.canSwing ? FindTarget(world) : 0;
+    if (target != 0) {
+      direction = target;
+      Set(input, ACTION_ATTACK, true, tickEnd);
+    }
+    // Ran into a wall last tick, so turns around rather than stay a target
+    if (target == 0 && direction == Blocked(player)) {
+      direction = -direction;
+      running = direction;
+    }
+    Set(input, ACTION_LEFT, direction < 0, tickEnd);
+    Set(input, ACTION_RIGHT, direction > 0, tickEnd);
+
+    if (down[ACTION_JUMP]) {
+      if (--jumpTicks <= 0) {
+        Set(input, ACTION_JUMP, false, tickEnd);
+      }
+    } else if (dodgeJump) {
+      Set(input, ACTION_JUMP, true, tickEnd);
+      jumpTicks = SCRIPT_MAX_JUMP_TICKS;
+    } else if (random.Below(SCRIPT_JUMP_CHANCE) == 0) {
+      Set(input, ACTION_JUMP, true, tickEnd);
+      jumpTicks = 1 + random.Below(SCRIPT_MAX_JUMP_TICKS);
+    }
+
+    input.BeginTickEndingAt(tickEnd);
+  }
+
+ private:
+  void Set(InputBuffer& input, InputAction action, bool on, double time) {
+    if (down[action] != on) {
+      input.Feed(action, on, time);
+      down[action] = on;
+    }
+  }
+
+  // Which way to run while nothing needs doing
+  int Wander() {
+    if (--runTicks <= 0) {
+      running = random.Below(2) == 0 ? -1 : 1;
+      runTicks = SCRIPT_MIN_RUN_TICKS +
+                 random.Below(SCRIPT_MAX_RUN_TICKS - SCRIPT_MIN_RUN_TICKS);
+    }
+    return running;
+  }
+
+  // The closest enemy about level with the player, or nullptr
+  static const Character* NearestEnemy(const World& world) {
+    const Player* player = world.player;
+    const Character* nearest = nullptr;
+    float nearestDistance = SCRIPT_CHASE_DISTANCE;
+    auto consider = [&](const Character* c) {
+      float distance = Vector2Distance(player->position, c->position);
+      if (distance < nearestDistance &&
+          fabsf(c->position.y - player->position.y) < SCRIPT_REACH_HEIGHT) {
+        nearest = c;
+        nearestDistance = distance;
+      }
+    };
+    for (const MeleeEnemy* m : world.activeMeleeEnemies) {
+      consider(m);
+    }
+    for (const RangedEnemy* r : world.level->rangedEnemies) {
+      consider(r);
+    }
+    return nearest;
+  }
+
+  // Which way the player pushed without moving last tick, 0 for neither
+  int Blocked(const Player* player) const {
+    if (down[ACTION_LEFT] && player->velocity.x >= 0) {
+      return -1;
+    }
+    if (down[ACTION_RIGHT] && player->velocity.x <= 0) {
+      return 1;
+    }
+    return 0;
+  }
+
+  // Which way to face to hit the nearest enemy or bullet in reach, 0 for
+  // none
+  static int FindTarget(const World& world) {
+    const Player* player = world.player;
+    int facing = player->facingDirection == "left" ? -1 : 1;
+    float nearest = SCRIPT_REACH_AHEAD;
+    int target = 0;
+    auto consider = [&](Vector2 position) {
+      float dx = position.x - player->position.x;
+      float dy = position.y - player->position.y;
+      if (fabsf(dy) >= SCRIPT_REACH_HEIGHT || fabsf(dx) >= nearest) {
+        return;
+      }
+      int side = dx < 0 ? -1 : 1;
+      if (fabsf(dx) < SCRIPT_REACH_BOTH_SIDES) {
+        side = facing;
+      }
+      nearest = fabsf(dx);
+      target = side;
+    };
+    for (const MeleeEnemy* m : world.activeMeleeEnemies) {
+      consider(m->position);
+    }
+    for (const RangedEnemy* r : world.level->rangedEnemies) {
+      consider(r->position);
+    }
+    for (const Bullet* b : world.level->bullets) {
+      if (Coming(player, b)) {
+        consider(b->position);  // a swing sends it back
+      }
+    }
+    return target;
+  }
+
+  // The closest bullet about to hit, or nullptr
+  static const Bullet* NearestComing(const World& world) {
+    const Player* player = world.player;
+    const Bullet* nearest = nullptr;
+    float nearestDistance = SCRIPT_BULLET_WARNING;
+    for (const Bullet* b : world.level->bullets) {
+      float distance = Vector2Distance(player->position, b->position);
+      if (distance < nearestDistance && Coming(player, b)) {
+        nearest = b;
+        nearestDistance = distance;
+      }
+    }
+    return nearest;
+  }
+
+  static bool Coming(const Player* player, const Bullet* b) {
+    Vector2 toPlayer = Vector2Subtract(player->position, b->position);
+    return Vector2DotProduct(toPlayer, b->direction) > 0;
+  }
+};
+
+#endif
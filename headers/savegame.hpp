@@ -0,0 +1,369 @@
+#ifndef SAVE_GAME
+#define SAVE_GAME
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "hash.hpp"
+#include "level.hpp"
+#include "scorestore.hpp"
+#include "snapshot.hpp"
+#include "world.hpp"
+
+const char* SAVE_FILENAME("savegame.sav");
+const char SAVE_MAGIC[4] = {'H', 'K', 'S', 'G'};
+// Bump SAVE_VERSION when the format changes. Only bump
+// SAVE_READABLE_SINCE when older versions could no longer make sense of
+// the file, adding fields or sections doesn't need it.
+const uint16_t SAVE_VERSION(2);
+const uint16_t SAVE_READABLE_SINCE(1);
+
+// One section per record type. Tags are never reused for something else.
+enum SaveSectionTag : uint32_t {
+  SAVE_WORLD = 1,
+  SAVE_PLAYER = 2,
+  SAVE_MELEE_ENEMIES = 3,
+  SAVE_RANGED_ENEMIES = 4,
+  SAVE_BULLETS = 5,
+  SAVE_ITEMS = 6,
+  SAVE_OBSTACLES = 7,
+  SAVE_SECTION_TAGS = 8,  // one past the last
+};
+
+// Followed by sections, the checksum covers all of them
+struct SaveHeader {
+  char magic[4];
+  uint16_t version;        // that wrote it
+  uint16_t readableSince;  // oldest version that can load it
+  uint32_t sections;
+  uint32_t reserved;
+  uint64_t levelHash;  // see HashLevelLayout, saves only load on their level
+  uint64_t checksum;
+};
+
+// Followed by count records of recordSize bytes each. recordSize is what
+// the record was when the file was written: a reader skips the bytes of
+// fields it doesn't know yet and zeroes the fields the writer didn't have,
+// and skips sections whose tag it doesn't know.
+struct SaveSection {
+  uint32_t tag;
+  uint32_t recordSize;
+  uint32_t count;
+  uint32_t reserved;
+};
+
+// What a save belongs to: the obstacles, the paths the moving ones take
+// and where items spawn, not where anything is right now
+uint64_t HashLevelLayout(const Level* level) {
+  uint64_t hash = HASH_SEED;
+  for (const Obstacle* o : level->obstacles) {
+    hash = HashBytes(&o->type, sizeof(o->type), hash);
+    hash = HashBytes(&o->halfSizes, sizeof(o->halfSizes), hash);
+    if (o->type == ObstacleType::STATIC) {
+      hash = HashBytes(&o->position, sizeof(o->position), hash);
+    } else {
+      hash = HashBytes(
+        o->path.points.data(), o->path.points.size() * sizeof(Vector2), hash
+      );
+      hash = HashBytes(
+        &o->path.numberOfSteps, sizeof(o->path.numberOfSteps), hash
+      );
+    }
+  }
+  return HashBytes(
+    level->itemSpawns.data(), level->itemSpawns.size() * sizeof(Vector2), hash
+  );
+}
+
+// The sizes of the records this build knows, by tag
+const uint32_t SAVE_RECORD_SIZES[SAVE_SECTION_TAGS] = {
+  0,
+  sizeof(WorldRecord),
+  sizeof(PlayerRecord),
+  sizeof(MeleeEnemyRecord),
+  sizeof(RangedEnemyRecord),
+  sizeof(BulletRecord),
+  sizeof(ItemRecord),
+  sizeof(ObstacleRecord),
+};
+
+// The sizes the records had in version 1. No version writes them smaller,
+// so a known section with smaller records is damaged.
+const uint32_t SAVE_MIN_RECORD_SIZES[SAVE_SECTION_TAGS] = {
+  0,
+  offsetof(WorldRecord, staggerPhase),
+  sizeof(PlayerRecord),
+  sizeof(MeleeEnemyRecord),
+  sizeof(RangedEnemyRecord),
+  sizeof(BulletRecord),
+  sizeof(ItemRecord),
+  sizeof(ObstacleRecord),
+};
+
+// More of anything than a game ever has, so a damaged count can't make
+// loading allocate without end
+const uint32_t SAVE_MAX_ENTITIES(65536);
+const uint32_t SAVE_MAX_RECORDS[SAVE_SECTION_TAGS] = {
+  0,
+  1,
+  1,
+  MELEE_ENEMY_SPAWN_COUNT,  // the world's whole pool
+  SAVE_MAX_ENTITIES,
+  SAVE_MAX_ENTITIES,
+  SAVE_MAX_ENTITIES,
+  SAVE_MAX_ENTITIES,
+};
+
+// Turns a World::Snapshot into the bytes of a save file. The snapshot's
+// records are already laid out one type after another, so each section is
+// one copy.
+void EncodeSave(
+  const WorldSnapshot& snapshot, uint64_t levelHash,
+  std::vector<unsigned char>& out
+) {
+  size_t at = 0;
+  WorldRecord world = snapshot.Read<WorldRecord>(at);
+  uint32_t counts[SAVE_SECTION_TAGS] = {};
+  counts[SAVE_WORLD] = 1;
+  counts[SAVE_PLAYER] = 1;
+  counts[SAVE_MELEE_ENEMIES] = world.meleeEnemies;
+  counts[SAVE_RANGED_ENEMIES] = world.rangedEnemies;
+  counts[SAVE_BULLETS] = world.bullets;
+  counts[SAVE_ITEMS] = world.items;
+  counts[SAVE_OBSTACLES] = world.obstacles;
+
+  out.resize(sizeof(SaveHeader));
+  at = 0;
+  for (uint32_t tag = SAVE_WORLD; tag < SAVE_SECTION_TAGS; ++tag) {
+    SaveSection section = {tag, SAVE_RECORD_SIZES[tag], counts[tag], 0};
+    size_t size = (size_t)section.recordSize * section.count;
+    size_t start = out.size();
+    out.resize(start + sizeof(SaveSection) + size);
+    memcpy(&out[start], &section, sizeof(SaveSection));
+    memcpy(&out[start + sizeof(SaveSection)], &snapshot.bytes[at], size);
+    at += size;
+  }
+
+  SaveHeader header;
+  memset(&header, 0, sizeof(SaveHeader));
+  memcpy(header.magic, SAVE_MAGIC, 4);
+  header.version = SAVE_VERSION;
+  header.readableSince = SAVE_READABLE_SINCE;
+  header.sections = SAVE_SECTION_TAGS - SAVE_WORLD;
+  header.levelHash = levelHash;
+  header.checksum =
+    HashBytes(&out[sizeof(SaveHeader)], out.size() - sizeof(SaveHeader));
+  memcpy(&out[0], &header, sizeof(SaveHeader));
+}
+
+// Back into a snapshot World::Restore takes, in this build's record
+// layout. False for anything damaged, too new or from another level.
+bool DecodeSave(
+  const std::vector<unsigned char>& bytes, uint64_t levelHash,
+  WorldSnapshot& into
+) {
+  SaveHeader header;
+  if (bytes.size() < sizeof(SaveHeader)) {
+    std::cerr << "Save file is too short" << std::endl;
+    return false;
+  }
+  memcpy(&header, &bytes[0], sizeof(SaveHeader));
+  if (memcmp(header.magic, SAVE_MAGIC, 4) != 0) {
+    std::cerr << "Not a save file" << std::endl;
+    return false;
+  }
+  if (header.readableSince > SAVE_VERSION) {
+    std::cerr << "Save file needs a newer version of the game" << std::endl;
+    return false;
+  }
+  if (header.checksum != HashBytes(
+                           bytes.data() + sizeof(SaveHeader),
+                           bytes.size() - sizeof(SaveHeader)
+                         )) {
+    std::cerr << "Save file is damaged" << std::endl;
+    return false;
+  }
+  if (header.levelHash != levelHash) {
+    std::cerr << "Save file is from a different level" << std::endl;
+    return false;
+  }
+
+  // Where each known section starts, sections can come in any order
+  SaveSection sections[SAVE_SECTION_TAGS] = {};
+  size_t starts[SAVE_SECTION_TAGS] = {};
+  size_t at = sizeof(SaveHeader);
+  for (uint32_t i = 0; i < header.sections; ++i) {
+    SaveSection section;
+    if (bytes.size() - at < sizeof(SaveSection)) {
+      std::cerr << "Save file is cut short" << std::endl;
+      return false;
+    }
+    memcpy(&section, &bytes[at], sizeof(SaveSection));
+    at += sizeof(SaveSection);
+    size_t size = (size_t)section.recordSize * section.count;
+    if (bytes.size() - at < size) {
+      std::cerr << "Save file is cut short" << std::endl;
+      return false;
+    }
+    if (section.tag > 0 && section.tag < SAVE_SECTION_TAGS) {
+      if (section.recordSize < SAVE_MIN_RECORD_SIZES[section.tag] ||
+          section.count > SAVE_MAX_RECORDS[section.tag]) {
+        std::cerr << "Save file is damaged" << std::endl;
+        return false;
+      }
+      sections[section.tag] = section;
+      starts[section.tag] = at;
+    }
+    at += size;
+  }
+  if (sections[SAVE_WORLD].count != 1 || sections[SAVE_PLAYER].count != 1) {
+    std::cerr << "Save file is missing the world or the player" << std::endl;
+    return false;
+  }
+
+  into.Clear();
+  for (uint32_t tag = SAVE_WORLD; tag < SAVE_SECTION_TAGS; ++tag) {
+    const SaveSection& section = sections[tag];
+    uint32_t known = SAVE_RECORD_SIZES[tag];
+    uint32_t copied = section.recordSize < known ? section.recordSize : known;
+    for (uint32_t i = 0; i < section.count; ++i) {
+      const unsigned char* record =
+        bytes.data() + starts[tag] + (size_t)i * section.recordSize;
+      memcpy(into.Append(known), record, copied);
+    }
+  }
+
+  // The counts follow the sections actually there
+  WorldRecord world;
+  memcpy(&world, &into.bytes[0], sizeof(WorldRecord));
+  world.meleeEnemies = sections[SAVE_MELEE_ENEMIES].count;
+  world.rangedEnemies = sections[SAVE_RANGED_ENEMIES].count;
+  world.bullets = sections[SAVE_BULLETS].count;
+  world.items = sections[SAVE_ITEMS].count;
+  world.obstacles = sections[SAVE_OBSTACLES].count;
+  memcpy(&into.bytes[0], &world, sizeof(WorldRecord));
+  return true;
+}
+
+bool ReadSaveFile(const char filename[], std::vector<unsigned char>& bytes) {
+  FILE* file = fopen(filename, "rb");
+  if (file == nullptr) {
+    std::cerr << "Unable to open " << filename << std::endl;
+    return false;
+  }
+  std::error_code error;
+  size_t size = std::filesystem::file_size(filename, error);
+  bytes.resize(error ? 0 : size);
+  bool read = !error && fread(bytes.data(), 1, size, file) == size;
+  fclose(file);
+  if (!read) {
+    std::cerr << "Unable to read " << filename << std::endl;
+  }
+  return read;
+}
+
+// Writes saves on a background thread, so saving costs the frame no more
+// than taking the snapshot. A save is written to a temporary file that is
+// then renamed over the old one, a crash never leaves half a save. Saves
+// queued faster than they're written only keep the newest.
+struct SaveWriter {
+  std::thread writer;
+  std::mutex saveMutex;
+  std::condition_variable saveReady;
+  WorldSnapshot pending;
+  uint64_t pendingLevelHash = 0;
+  std::string pendingFilename;
+  bool hasPending = false;
+  bool stopping = false;
+
+  ~SaveWriter() { Stop(); }
+
+  void Queue(
+    const WorldSnapshot& snapshot, uint64_t levelHash, const char filename[]
+  ) {
+    if (!writer.joinable()) {
+      stopping = false;
+      writer = std::thread(&SaveWriter::WriterLoop, this);
+    }
+    {
+      std::lock_guard<std::mutex> lock(saveMutex);
+      pending.bytes = snapshot.bytes;
+      pendingLevelHash = levelHash;
+      pendingFilename = filename;
+      hasPending = true;
+    }
+    saveReady.notify_one();
+  }
+
+  // Writes what's still queued and stops the writer
+  void Stop() {
+    if (writer.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(saveMutex);
+        stopping = true;
+      }
+      saveReady.notify_all();
+      writer.join();
+    }
+  }
+
+ private:
+  void WriterLoop() {
+    WorldSnapshot saving;
+    std::vector<unsigned char> bytes;
+    std::string filename;
+    while (true) {
+      uint64_t levelHash;
+      {
+        std::unique_lock<std::mutex> lock(saveMutex);
+        saveReady.wait(lock, [this] { return stopping || hasPending; });
+        if (!hasPending) {
+          return;
+        }
+        saving.bytes.swap(pending.bytes);
+        levelHash = pendingLevelHash;
+        filename.swap(pendingFilename);
+        hasPending = false;
+      }
+      EncodeSave(saving, levelHash, bytes);
+      WriteFile(filename, bytes);
+    }
+  }
+
+  static bool WriteFile(
+    const std::string& filename, const std::vector<unsigned char>& bytes
+  ) {
+    std::string temporaryFilename = filename + ".tmp";
+    FILE* file = fopen(temporaryFilename.c_str(), "wb");
+    if (file == nullptr) {
+      std::cerr << "Unable to write " << temporaryFilename << std::endl;
+      return false;
+    }
+    bool written = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    SyncFile(file);
+    fclose(file);
+
+    std::error_code error;
+    if (written) {
+      std::filesystem::rename(temporaryFilename, filename, error);
+    }
+    if (!written || error) {
+      std::cerr << "Unable to write " << filename << std::endl;
+      std::filesystem::remove(temporaryFilename, error);
+      return false;
+    }
+    return true;
+  }
+};
+
+#endif
@@ -0,0 +1,451 @@
+#ifndef SCORE_STORE
+#define SCORE_STORE
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "hash.hpp"
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+const char* SCORE_LOG_FILENAME("scores.log");
+const char* SCORE_INDEX_FILENAME("scores.idx");
+
+const char SCORE_LOG_MAGIC[4] = {'H', 'K', 'S', 'L'};
+const char SCORE_INDEX_MAGIC[4] = {'H', 'K', 'S', 'I'};
+const uint32_t SCORE_LOG_VERSION(1);
+// Version 1 indexes only checksummed their records, they still load
+const uint32_t SCORE_INDEX_VERSION(2);
+const int SCORE_NAME_LENGTH(16);
+// Runs that can pile up in the log before they are merged into the index
+const size_t SCORE_COMPACT_THRESHOLD(4096);
+
+struct ScoreRecord {
+  int32_t score;
+  uint32_t reserved;
+  uint64_t sequence;             // order of arrival
+  char name[SCORE_NAME_LENGTH];  // null terminated
+};
+
+// The checksum covers the record, so a torn write at the end of the log is
+// spotted and dropped
+struct ScoreLogRecord {
+  ScoreRecord record;
+  uint64_t checksum;
+};
+
+struct ScoreLogHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t logId;
+};
+
+// Followed by count ScoreRecords best first, then count uint32_t positions
+// in that list sorted by name. The checksum covers the header, with the
+// checksum itself as 0, and both lists.
+struct ScoreIndexHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t count;
+  uint64_t coveredLogId;   // the log this index has merged up to
+  uint64_t coveredOffset;  // how far into that log
+  uint64_t nextSequence;
+  uint64_t checksum;
+};
+
+// Higher scores first, and earlier runs first among equal scores
+bool RanksBefore(const ScoreRecord& a, const ScoreRecord& b) {
+  if (a.score != b.score) {
+    return a.score > b.score;
+  }
+  return a.sequence < b.sequence;
+}
+
+// Makes sure what was written is on the disk, not only in the OS cache
+void SyncFile(FILE* file) {
+  fflush(file);
+#if defined(_WIN32)
+  _commit(_fileno(file));
+#else
+  fsync(fileno(file));
+#endif
+}
+
+// Every finished run, kept in two files:
+// - scores.log, which every new run is appended to and synced right away
+// - scores.idx, a sorted snapshot that the log is merged into every
+//   SCORE_COMPACT_THRESHOLD runs
+//
+// Both files are replaced by writing a temporary file and renaming it over
+// the old one, and the index records which log and offset it covers, so a
+// crash at any point loses at most the run being appended. The index and
+// log from before the last compaction stay around as scores.idx.old and
+// scores.log.old, so a damaged index falls back to the one before it and
+// replays both logs on top.
+//
+// Queries binary search the index and merge in the runs from the log,
+// which are few, so they stay fast with millions of runs stored. Not
+// thread-safe, callers lock around it.
+struct ScoreStore {
+  std::string logFilename, indexFilename;
+  std::vector<ScoreRecord> ranked;  // from the index, best first
+  std::vector<uint32_t> byName;     // into ranked, by name then rank
+  std::vector<ScoreRecord> recent;  // from the log since, best first
+  uint64_t logId = 0;
+  uint64_t nextSequence = 0;
+  FILE* log = nullptr;
+
+  bool Open(const char logFile[], const char indexFile[]) {
+    Close();
+    logFilename = logFile;
+    indexFilename = indexFile;
+    ranked.clear();
+    byName.clear();
+    recent.clear();
+    nextSequence = 0;
+
+    ScoreIndexHeader index;
+    if (!LoadIndex(indexFilename, index) &&
+        !LoadIndex(indexFilename + ".old", index)) {
+      index.coveredLogId = 0;
+      index.coveredOffset = 0;
+    }
+    return OpenLog(index.coveredLogId, index.coveredOffset);
+  }
+
+  void Close() {
+    if (log != nullptr) {
+      fclose(log);
+      log = nullptr;
+    }
+  }
+
+  bool IsOpen() const { return log != nullptr; }
+
+  size_t Count() const { return ranked.size() + recent.size(); }
+
+  // Durable once this returns true
+  bool Append(int score, const std::string& name, ScoreRecord& out) {
+    if (log == nullptr) {
+      return false;
+    }
+    ScoreLogRecord entry;
+    memset(&entry, 0, sizeof(ScoreLogRecord));
+    entry.record.score = score;
+    entry.record.sequence = nextSequence;
+    strncpy(entry.record.name, name.c_str(), SCORE_NAME_LENGTH - 1);
+    entry.checksum = HashBytes(&entry.record, sizeof(ScoreRecord));
+
+    if (fwrite(&entry, sizeof(ScoreLogRecord), 1, log) != 1) {
+      std::cerr << "Unable to append to " << logFilename << std::endl;
+      return false;
+    }
+    SyncFile(log);
+    ++nextSequence;
+
+    recent.insert(
+      std::upper_bound(recent.begin(), recent.end(), entry.record, RanksBefore),
+      entry.record
+    );
+    out = entry.record;
+    return true;
+  }
+
+  bool NeedsCompaction() const {
+    return recent.size() >= SCORE_COMPACT_THRESHOLD;
+  }
+
+  // Merges the log into a new index, then starts an empty log
+  bool Compact() {
+    std::vector<ScoreRecord> merged;
+    merged.reserve(Count());
+    std::merge(
+      ranked.begin(), ranked.end(), recent.begin(), recent.end(),
+      std::back_inserter(merged), RanksBefore
+    );
+    std::vector<uint32_t> mergedByName(merged.size());
+    std::iota(mergedByName.begin(), mergedByName.end(), 0);
+    std::sort(
+      mergedByName.begin(), mergedByName.end(),
+      [&merged](uint32_t a, uint32_t b) {
+        int order = strncmp(merged[a].name, merged[b].name, SCORE_NAME_LENGTH);
+        return order != 0 ? order < 0 : a < b;
+      }
+    );
+
+    ScoreIndexHeader header;
+    memset(&header, 0, sizeof(ScoreIndexHeader));
+    memcpy(header.magic, SCORE_INDEX_MAGIC, 4);
+    header.version = SCORE_INDEX_VERSION;
+    header.count = merged.size();
+    header.coveredLogId = logId;
+    std::error_code error;
+    header.coveredOffset = std::filesystem::file_size(logFilename, error);
+    if (error) {
+      return false;
+    }
+    header.nextSequence = nextSequence;
+    header.checksum = IndexChecksum(header, merged, mergedByName);
+
+    std::string temporaryFilename = indexFilename + ".tmp";
+    FILE* indexFile = fopen(temporaryFilename.c_str(), "wb");
+    if (indexFile == nullptr) {
+      std::cerr << "Unable to write " << temporaryFilename << std::endl;
+      return false;
+    }
+    bool written =
+      fwrite(&header, sizeof(ScoreIndexHeader), 1, indexFile) == 1 &&
+      fwrite(merged.data(), sizeof(ScoreRecord), merged.size(), indexFile) ==
+        merged.size() &&
+      fwrite(
+        mergedByName.data(), sizeof(uint32_t), mergedByName.size(), indexFile
+      ) == mergedByName.size();
+    SyncFile(indexFile);
+    fclose(indexFile);
+
+    if (written && std::filesystem::exists(indexFilename, error)) {
+      std::filesystem::rename(indexFilename, indexFilename + ".old", error);
+    }
+    if (written && !error) {
+      std::filesystem::rename(temporaryFilename, indexFilename, error);
+    }
+    if (!written || error) {
+      std::cerr << "Unable to write " << indexFilename << std::endl;
+      std::filesystem::remove(temporaryFilename, error);
+      return false;
+    }
+
+    ranked.swap(merged);
+    byName.swap(mergedByName);
+    recent.clear();
+    return StartLog(logId + 1);
+  }
+
+  // Best first
+  std::vector<ScoreRecord> TopK(size_t k) const {
+    std::vector<ScoreRecord> top;
+    size_t i = 0, j = 0;
+    while (top.size() < k && (i < ranked.size() || j < recent.size())) {
+      if (j >= recent.size() ||
+          (i < ranked.size() && RanksBefore(ranked[i], recent[j]))) {
+        top.push_back(ranked[i++]);
+      } else {
+        top.push_back(recent[j++]);
+      }
+    }
+    return top;
+  }
+
+  // 1 for the best score. Runs tied on score share a rank.
+  size_t RankOf(int score) const {
+    return 1 + CountAbove(ranked, score) + CountAbove(recent, score);
+  }
+
+  // Best first
+  std::vector<ScoreRecord> ScoresOf(const std::string& name) const {
+    char key[SCORE_NAME_LENGTH] = {0};
+    strncpy(key, name.c_str(), SCORE_NAME_LENGTH - 1);
+
+    std::vector<ScoreRecord> found;
+    auto first = std::lower_bound(
+      byName.begin(), byName.end(), key,
+      [this](uint32_t i, const char* name) {
+        return strncmp(ranked[i].name, name, SCORE_NAME_LENGTH) < 0;
+      }
+    );
+    auto last = std::upper_bound(
+      first, byName.end(), key,
+      [this](const char* name, uint32_t i) {
+        return strncmp(name, ranked[i].name, SCORE_NAME_LENGTH) < 0;
+      }
+    );
+    for (auto i = first; i != last; ++i) {
+      found.push_back(ranked[*i]);  // Already best first, see Compact
+    }
+
+    size_t fromIndex = found.size();
+    for (const ScoreRecord& record : recent) {
+      if (strncmp(record.name, key, SCORE_NAME_LENGTH) == 0) {
+        found.push_back(record);
+      }
+    }
+    std::inplace_merge(
+      found.begin(), found.begin() + fromIndex, found.end(), RanksBefore
+    );
+    return found;
+  }
+
+ private:
+  static size_t CountAbove(const std::vector<ScoreRecord>& records, int score) {
+    return std::partition_point(
+             records.begin(), records.end(),
+             [score](const ScoreRecord& r) { return r.score > score; }
+           ) -
+           records.begin();
+  }
+
+  static uint64_t IndexChecksum(
+    ScoreIndexHeader header, const std::vector<ScoreRecord>& records,
+    const std::vector<uint32_t>& names
+  ) {
+    uint64_t hash = HASH_SEED;
+    if (header.version >= 2) {
+      header.checksum = 0;
+      hash = HashBytes(&header, sizeof(ScoreIndexHeader));
+    }
+    hash =
+      HashBytes(records.data(), records.size() * sizeof(ScoreRecord), hash);
+    return HashBytes(names.data(), names.size() * sizeof(uint32_t), hash);
+  }
+
+  bool LoadIndex(const std::string& filename, ScoreIndexHeader& header) {
+    FILE* indexFile = fopen(filename.c_str(), "rb");
+    if (indexFile == nullptr) {
+      return false;  // First run
+    }
+    std::error_code error;
+    uint64_t fileSize = std::filesystem::file_size(filename, error);
+    const uint64_t entrySize = sizeof(ScoreRecord) + sizeof(uint32_t);
+    bool valid = !error &&
+                 fread(&header, sizeof(ScoreIndexHeader), 1, indexFile) == 1 &&
+                 memcmp(header.magic, SCORE_INDEX_MAGIC, 4) == 0 &&
+                 header.version >= 1 && header.version <= SCORE_INDEX_VERSION &&
+                 // Nothing is allocated for a count the file can't hold
+                 header.count ==
+                   (fileSize - sizeof(ScoreIndexHeader)) / entrySize &&
+                 fileSize ==
+                   sizeof(ScoreIndexHeader) + header.count * entrySize;
+    if (valid) {
+      ranked.resize(header.count);
+      byName.resize(header.count);
+      valid =
+        fread(ranked.data(), sizeof(ScoreRecord), header.count, indexFile) ==
+          header.count &&
+        fread(byName.data(), sizeof(uint32_t), header.count, indexFile) ==
+          header.count &&
+        IndexChecksum(header, ranked, byName) == header.checksum;
+    }
+    fclose(indexFile);
+
+    if (!valid) {
+      std::cerr << filename << " is damaged, ignoring it" << std::endl;
+      ranked.clear();
+      byName.clear();
+      return false;
+    }
+    nextSequence = header.nextSequence;
+    return true;
+  }
+
+  // Replays whatever the index doesn't cover yet, from the log before the
+  // current one too in case the index is the one before the last
+  bool OpenLog(uint64_t coveredLogId, uint64_t coveredOffset) {
+    uint64_t offset;
+    uint64_t oldId =
+      ReplayLog(logFilename + ".old", coveredLogId, coveredOffset, offset);
+    uint64_t id = ReplayLog(logFilename, coveredLogId, coveredOffset, offset);
+    std::sort(recent.begin(), recent.end(), RanksBefore);
+    if (id == 0 || id < coveredLogId) {
+      // Missing, or already merged into the index before a crash
+      return StartLog(std::max(coveredLogId, oldId) + 1);
+    }
+
+    // Cut off a record that was only half written, so appends line up
+    std::error_code error;
+    if (std::filesystem::file_size(logFilename, error) != offset && !error) {
+      std::cerr << "Dropping a damaged record at the end of " << logFilename
+                << std::endl;
+      std::filesystem::resize_file(logFilename, offset, error);
+    }
+
+    logId = id;
+    log = fopen(logFilename.c_str(), "ab");
+    return log != nullptr;
+  }
+
+  // Adds the runs from a log the index doesn't cover to recent. Returns
+  // the log's id, 0 if it's missing, and where its last whole record ends.
+  uint64_t ReplayLog(
+    const std::string& filename, uint64_t coveredLogId, uint64_t coveredOffset,
+    uint64_t& offset
+  ) {
+    FILE* logFile = fopen(filename.c_str(), "rb");
+    ScoreLogHeader header;
+    if (logFile == nullptr ||
+        fread(&header, sizeof(ScoreLogHeader), 1, logFile) != 1 ||
+        memcmp(header.magic, SCORE_LOG_MAGIC, 4) != 0 ||
+        header.version != SCORE_LOG_VERSION) {
+      if (logFile != nullptr) {
+        fclose(logFile);
+      }
+      return 0;
+    }
+
+    offset = sizeof(ScoreLogHeader);
+    if (header.logId == coveredLogId) {
+      offset = coveredOffset;
+    }
+    if (header.logId >= coveredLogId) {
+      fseek(logFile, offset, SEEK_SET);
+      ScoreLogRecord entry;
+      while (fread(&entry, sizeof(ScoreLogRecord), 1, logFile) == 1 &&
+             HashBytes(&entry.record, sizeof(ScoreRecord)) == entry.checksum) {
+        recent.push_back(entry.record);
+        nextSequence = std::max(nextSequence, entry.record.sequence + 1);
+        offset += sizeof(ScoreLogRecord);
+      }
+    }
+    fclose(logFile);
+    return header.logId;
+  }
+
+  // Swaps in a fresh, empty log
+  bool StartLog(uint64_t id) {
+    Close();
+    ScoreLogHeader header;
+    memset(&header, 0, sizeof(ScoreLogHeader));
+    memcpy(header.magic, SCORE_LOG_MAGIC, 4);
+    header.version = SCORE_LOG_VERSION;
+    header.logId = id;
+
+    std::string temporaryFilename = logFilename + ".tmp";
+    FILE* logFile = fopen(temporaryFilename.c_str(), "wb");
+    if (logFile == nullptr) {
+      std::cerr << "Unable to write " << temporaryFilename << std::endl;
+      return false;
+    }
+    bool written = fwrite(&header, sizeof(ScoreLogHeader), 1, logFile) == 1;
+    SyncFile(logFile);
+    fclose(logFile);
+
+    std::error_code error;
+    if (written && std::filesystem::exists(logFilename, error)) {
+      std::filesystem::rename(logFilename, logFilename + ".old", error);
+    }
+    if (written && !error) {
+      std::filesystem::rename(temporaryFilename, logFilename, error);
+    }
+    if (!written || error) {
+      std::cerr << "Unable to write " << logFilename << std::endl;
+      return false;
+    }
+
+    logId = id;
+    log = fopen(logFilename.c_str(), "ab");
+    return log != nullptr;
+  }
+};
+
+#endif
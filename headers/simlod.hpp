@@ -0,0 +1,104 @@
+#ifndef SIMLOD
+#define SIMLOD
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include "camera.hpp"
+#include "entity.hpp"
+
+// Distances are measured from the edge of the camera view, in world units
+const float LOD_FULL_RATE_RANGE(200);
+const float LOD_REDUCED_RATE_RANGE(800);
+const float LOD_HYSTERESIS(50);  // extra distance needed before demoting
+
+// Reduced-rate enemies integrate this many ticks in one update. Max fall
+// speed times this has to stay under the platform thickness (40) or they
+// tunnel through floors.
+const int LOD_REDUCED_INTERVAL(3);
+
+// Picks how often each enemy is simulated based on how far it is from what
+// the player can see. Full-rate enemies update every tick, reduced-rate ones
+// every few ticks with their movement scaled up to cover the skipped time,
+// and dormant ones are frozen in place until the camera comes near.
+struct SimulationScheduler {
+  Rectangle view;
+  int tierCounts[3] = {0, 0, 0};  // Schedule calls per tier since Begin
+  int staggerPhase = 0;
+
+  void Begin(const Rectangle cameraBounds) {
+    view = cameraBounds;
+    tierCounts[FULL_RATE] = 0;
+    tierCounts[REDUCED_RATE] = 0;
+    tierCounts[DORMANT] = 0;
+  }
+
+  // Returns whether the character should run its update this tick and sets
+  // its timeScale to the number of ticks that update has to cover
+  bool Schedule(Character* c) {
+    UpdateTier tier = PickTier(c);
+
+    if (tier != c->updateTier) {
+      if (c->updateTier == DORMANT) {
+        // Time spent frozen is dropped, it resumes where it was left
+        c->ticksSinceUpdate = 0;
+      } else if (tier == REDUCED_RATE) {
+        // Spread reduced-rate updates across ticks instead of bunching them
+        c->ticksSinceUpdate = staggerPhase;
+        staggerPhase = (staggerPhase + 1) % LOD_REDUCED_INTERVAL;
+      }
+      c->updateTier = tier;
+    }
+    ++tierCounts[tier];
+    ++c->ticksSinceUpdate;
+
+    switch (tier) {
+      case FULL_RATE:
+        // Anything owed from the reduced tier is caught up here
+        c->timeScale = (float)c->ticksSinceUpdate;
+        c->ticksSinceUpdate = 0;
+        return true;
+      case REDUCED_RATE:
+        if (c->ticksSinceUpdate < LOD_REDUCED_INTERVAL) {
+          return false;
+        }
+        c->timeScale = (float)c->ticksSinceUpdate;
+        c->ticksSinceUpdate = 0;
+        return true;
+      default:
+        c->ticksSinceUpdate = 0;
+        return false;
+    }
+  }
+
+ private:
+  UpdateTier PickTier(Character* c) {
+    float distance = DistanceToView(c->position);
+    // Demoting needs a bit more distance than promoting so enemies sitting
+    // on a boundary don't flip tiers every tick
+    float slack = 0;
+    if (c->updateTier == FULL_RATE) {
+      slack = LOD_HYSTERESIS;
+    }
+    if (distance <= LOD_FULL_RATE_RANGE + slack) {
+      return FULL_RATE;
+    }
+
+    slack = 0;
+    if (c->updateTier != DORMANT) {
+      slack = LOD_HYSTERESIS;
+    }
+    if (distance <= LOD_REDUCED_RATE_RANGE + slack) {
+      return REDUCED_RATE;
+    }
+    return DORMANT;
+  }
+
+  float DistanceToView(const Vector2 point) {
+    float dx = fmaxf(fmaxf(view.x - point.x, 0), point.x - (view.x + view.width));
+    float dy = fmaxf(fmaxf(view.y - point.y, 0), point.y - (view.y + view.height));
+    return sqrtf(dx * dx + dy * dy);
+  }
+};
+
+#endif
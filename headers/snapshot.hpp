@@ -0,0 +1,174 @@
+#ifndef SNAPSHOT
+#define SNAPSHOT
+
+#include <raylib.h>
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "entity.hpp"
+
+// The records a World is saved as. Plain data only, every one is copied in
+// and out of a snapshot with memcpy. Timers are kept as ticks left until
+// they fire, 0 for one that isn't pending, so a snapshot doesn't depend on
+// the timer wheel's clock.
+//
+// Save files store these as they are, see savegame.hpp. So that old saves
+// keep loading, fields are only ever added at the end, in place of the
+// reserved bytes or after them, and 0 has to work as their default. The
+// reserved bytes fill what would otherwise be padding, every byte of a
+// record is written.
+
+struct WorldRecord {
+  uint64_t elapsed;  // ticks since the game started
+  uint32_t random;
+  float swingCooldownBuff;
+  uint32_t attackAnimationIn;
+  uint32_t swingCooldownIn;
+  uint32_t waveIn;
+  uint32_t meleeEnemies;  // how many of each record follow
+  uint32_t rangedEnemies;
+  uint32_t bullets;
+  uint32_t items;
+  uint32_t obstacles;
+  bool inAttackAnimation;
+  bool canSwing;
+  uint8_t reserved[2];
+  int staggerPhase;  // of the SimulationScheduler
+  Vector2 cameraTarget;
+};
+
+struct CharacterRecord {
+  Vector2 position;
+  Vector2 velocity;
+  int health;
+  UpdateTier updateTier;
+  int ticksSinceUpdate;
+  float timeScale;
+  uint32_t random;
+};
+
+struct PlayerRecord {
+  CharacterRecord body;
+  int jumpFrame;
+  int framesAfterFallingOff;
+  int kills;
+  int killsThreshold;
+  Vector2 weaponPosition;
+  float airControlFactor;
+  bool isGrounded;
+  bool facingLeft;
+  uint8_t reserved[2];
+};
+
+struct MeleeEnemyRecord {
+  CharacterRecord body;
+  int jumpFrame;
+  float speedModifier;
+  int untilTurn;
+  uint32_t wakeIn;
+  bool active;
+  bool isMovingLeft;
+  bool isMovingRight;
+  bool isJumping;
+  bool isGrounded;
+  bool isFollowingPlayer;
+  uint8_t reserved[2];
+};
+
+struct RangedEnemyRecord {
+  CharacterRecord body;
+  Heading heading;
+  uint32_t wakeIn;
+};
+
+struct BulletRecord {
+  Vector2 position;
+  Vector2 direction;
+  float speed;
+};
+
+struct ItemRecord {
+  Vector2 position;
+};
+
+struct ObstacleRecord {  // moving ones only, static ones never change
+  Vector2 position;
+  int progress;
+  bool isMovingForward;
+  uint8_t reserved[3];
+};
+
+// A whole world in one contiguous buffer. Taking one into a snapshot that
+// was used before doesn't allocate unless the world has grown past it.
+struct WorldSnapshot {
+  std::vector<unsigned char> bytes;
+
+  void Clear() { bytes.clear(); }
+
+  bool IsEmpty() const { return bytes.empty(); }
+
+  template <typename T>
+  void Write(const T& record) {
+    static_assert(std::is_trivially_copyable<T>::value, "records are memcpy'd");
+    memcpy(Append(sizeof(T)), &record, sizeof(T));
+  }
+
+  // size more bytes at the end, zeroed
+  unsigned char* Append(size_t size) {
+    size_t at = bytes.size();
+    bytes.resize(at + size);
+    return &bytes[at];
+  }
+
+  // Reads the record at, then moves at past it
+  template <typename T>
+  T Read(size_t& at) const {
+    T record;
+    memcpy(&record, &bytes[at], sizeof(T));
+    at += sizeof(T);
+    return record;
+  }
+};
+
+// The last capacity snapshots, oldest overwritten first. Every slot keeps
+// its buffer, so once the ring has gone around, pushing doesn't allocate.
+struct RewindBuffer {
+  std::vector<WorldSnapshot> slots;
+  int newest = -1;
+  int count = 0;
+
+  explicit RewindBuffer(int capacity) : slots(capacity) {}
+
+  // Returns the slot to take the next snapshot into
+  WorldSnapshot& Push() {
+    newest = (newest + 1) % slots.size();
+    if (count < (int)slots.size()) {
+      ++count;
+    }
+    return slots[newest];
+  }
+
+  // The most recent snapshot, nullptr when empty
+  const WorldSnapshot* Newest() const {
+    return count > 0 ? &slots[newest] : nullptr;
+  }
+
+  // Drops the newest, the one before it becomes the newest
+  void Pop() {
+    if (count == 0) {
+      return;
+    }
+    newest = (newest + slots.size() - 1) % slots.size();
+    --count;
+  }
+
+  void Clear() {
+    newest = -1;
+    count = 0;
+  }
+};
+
+#endif
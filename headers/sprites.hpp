@@ -0,0 +1,39 @@
+#ifndef SPRITES
+#define SPRITES
+
+// Every image the game draws. The atlas packer and the runtime both go
+// through this list, so adding a sprite means adding it here and
+// re-running the packer.
+
+const char* ATLAS_TABLE_FILENAME("./assets/atlas.txt");
+
+enum SpriteId {
+  SPRITE_KNIGHT = 0,
+  SPRITE_SWORD_IDLE,
+  SPRITE_SWORD_ATTACK,
+  SPRITE_ENEMY_MELEE,
+  SPRITE_ENEMY_RANGED,
+  SPRITE_HEART_FULL,
+  SPRITE_HEART_HALF,
+  SPRITE_HEART_EMPTY,
+  SPRITE_FLOOR,
+  SPRITE_MAIN_MENU_BACKGROUND,
+  SPRITE_GAME_OVER_BACKGROUND,
+  SPRITE_COUNT,
+};
+
+const char* SPRITE_FILES[SPRITE_COUNT] = {
+  "./assets/knight.png",
+  "./assets/swordIdle.png",
+  "./assets/swordAttack.png",
+  "./assets/enemyMelee.png",
+  "./assets/enemyRanged.png",
+  "./assets/Heart_Full.png",
+  "./assets/Heart_Half.png",
+  "./assets/Heart_Empty.png",
+  "./assets/Floor.png",
+  "./assets/Hakenslash.png",
+  "./assets/GameOver.png",
+};
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef STATE_HASH
+#define STATE_HASH
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "hash.hpp"
+#include "snapshot.hpp"
+
+// Every tick the world's state is hashed, one hash per subsystem, and
+// streamed to a file. Two runs given the same input have to produce the
+// same stream, hashcompare finds the first tick where they don't and which
+// subsystems went their own way.
+const char* STATE_HASH_FILENAME("statehash.bin");
+const char STATE_HASH_MAGIC[4] = {'H', 'K', 'S', 'H'};
+
+enum StateSubsystem {
+  STATE_WORLD,   // timers, wave pacing, camera, how many of everything
+  STATE_RANDOM,  // the world's generator, characters hash their own
+  STATE_PLAYER,
+  STATE_MELEE_ENEMIES,
+  STATE_RANGED_ENEMIES,
+  STATE_BULLETS,
+  STATE_ITEMS,
+  STATE_OBSTACLES,
+  STATE_SUBSYSTEMS,
+};
+
+const char* STATE_SUBSYSTEM_NAMES[] = {
+  "world",   "random", "player", "melee enemies", "ranged enemies",
+  "bullets", "items",  "obstacles",
+};
+
+struct StateHashHeader {
+  char magic[4];
+  uint32_t subsystems;  // hashes per tick
+};
+
+struct StateHash {
+  uint64_t tick;  // World::Elapsed() after the tick
+  uint64_t subsystems[STATE_SUBSYSTEMS];
+};
+
+// From the snapshot taken after a tick. A snapshot is the whole simulation
+// state in a couple of kilobytes, and its records are already grouped by
+// subsystem, so this is one pass over it.
+StateHash HashState(const WorldSnapshot& snapshot) {
+  size_t at = 0;
+  WorldRecord world = snapshot.Read<WorldRecord>(at);
+  StateHash hash;
+  hash.tick = world.elapsed;
+  hash.subsystems[STATE_RANDOM] = HashBytes(&world.random, sizeof(uint32_t));
+  world.random = 0;
+  hash.subsystems[STATE_WORLD] = HashBytes(&world, sizeof(WorldRecord));
+
+  const size_t sizes[STATE_SUBSYSTEMS] = {
+    0,
+    0,
+    sizeof(PlayerRecord),
+    world.meleeEnemies * sizeof(MeleeEnemyRecord),
+    world.rangedEnemies * sizeof(RangedEnemyRecord),
+    world.bullets * sizeof(BulletRecord),
+    world.items * sizeof(ItemRecord),
+    world.obstacles * sizeof(ObstacleRecord),
+  };
+  for (int s = STATE_PLAYER; s < STATE_SUBSYSTEMS; ++s) {
+    hash.subsystems[s] = HashBytes(snapshot.bytes.data() + at, sizes[s]);
+    at += sizes[s];
+  }
+  return hash;
+}
+
+// Appends one StateHash per tick. Written through stdio's buffer, a tick
+// costs a copy into it.
+struct StateHashWriter {
+  FILE* file = nullptr;
+
+  ~StateHashWriter() { Close(); }
+
+  // Starts the file over
+  bool Open(const char filename[]) {
+    Close();
+    file = fopen(filename, "wb");
+    if (file == nullptr) {
+      std::cerr << "Unable to write " << filename << std::endl;
+      return false;
+    }
+    StateHashHeader header;
+    memcpy(header.magic, STATE_HASH_MAGIC, 4);
+    header.subsystems = STATE_SUBSYSTEMS;
+    fwrite(&header, sizeof(StateHashHeader), 1, file);
+    return true;
+  }
+
+  void Write(const StateHash& hash) {
+    if (file != nullptr) {
+      fwrite(&hash, sizeof(StateHash), 1, file);
+    }
+  }
+
+  void Close() {
+    if (file != nullptr) {
+      fclose(file);
+      file = nullptr;
+    }
+  }
+};
+
+bool ReadStateHashes(const char filename[], std::vector<StateHash>& hashes) {
+  FILE* file = fopen(filename, "rb");
+  if (file == nullptr) {
+    std::cerr << "Unable to open " << filename << std::endl;
+    return false;
+  }
+  StateHashHeader header;
+  if (fread(&header, sizeof(StateHashHeader), 1, file) != 1 ||
+      memcmp(header.magic, STATE_HASH_MAGIC, 4) != 0 ||
+      header.subsystems != STATE_SUBSYSTEMS) {
+    std::cerr << filename << " isn't a state hash stream of this version"
+              << std::endl;
+    fclose(file);
+    return false;
+  }
+  hashes.clear();
+  StateHash hash;
+  while (fread(&hash, sizeof(StateHash), 1, file) == 1) {
+    hashes.push_back(hash);
+  }
+  fclose(file);
+  return true;
+}
+
+#endif
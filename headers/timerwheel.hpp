@@ -0,0 +1,203 @@
+#ifndef TIMER_WHEEL
+#define TIMER_WHEEL
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// Four levels of 64 slots. Each level covers 64 times the span of the one
+// below it, so up to 2^24 ticks (over three days at 60 ticks a second) can
+// be scheduled directly. Anything further out is parked in the last level
+// and moved down as time gets closer.
+const int TIMER_WHEEL_LEVELS(4);
+const int TIMER_WHEEL_SLOT_BITS(6);
+const int TIMER_WHEEL_SLOTS(1 << TIMER_WHEEL_SLOT_BITS);
+
+// Stays safe to use after its timer fired or was cancelled, it then simply
+// stops matching
+struct TimerHandle {
+  uint32_t index = 0;  // 0 is never a timer, see TimerWheel
+  uint32_t generation = 0;
+};
+
+// Schedules callbacks on exact ticks of the fixed timestep. Scheduling and
+// cancelling are O(1), and a pending timer costs nothing per tick: Advance
+// only looks at the one slot that is due, plus an occasional cascade of a
+// higher level slot into the levels below.
+//
+// Timers live in one pool linked by index, every slot being a circular
+// list with a sentinel node. Callbacks may schedule and cancel timers,
+// including ones due on the same tick.
+struct TimerWheel {
+  struct Node {
+    uint32_t prev, next;
+    uint32_t generation = 0;
+    uint64_t expires = 0;
+    std::function<void()> callback;
+  };
+
+  std::vector<Node> nodes;
+  uint32_t freeList = 0;  // linked through next, 0 when empty
+  uint64_t now = 0;
+  size_t count = 0;
+
+  TimerWheel() {
+    // Sentinels: one per slot, then one for the list being fired
+    nodes.resize(TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS + 1);
+    for (uint32_t i = 0; i < nodes.size(); ++i) {
+      nodes[i].prev = i;
+      nodes[i].next = i;
+    }
+  }
+
+  // Fires on the Advance that reaches now + delay. A delay of 0 is treated
+  // as 1, the current tick has already been handled.
+  TimerHandle Schedule(uint64_t delay, std::function<void()> callback) {
+    uint32_t index = Allocate();
+    Node& node = nodes[index];
+    node.expires = now + (delay > 0 ? delay : 1);
+    node.callback = std::move(callback);
+    Link(index);
+    ++count;
+    return {index, node.generation};
+  }
+
+  // False if it already fired or was cancelled
+  bool Cancel(TimerHandle& handle) {
+    if (!IsPending(handle)) {
+      return false;
+    }
+    Unlink(handle.index);
+    Free(handle.index);
+    handle = {};
+    return true;
+  }
+
+  bool IsPending(TimerHandle handle) const {
+    return handle.index > FiringSentinel() && handle.index < nodes.size() &&
+           nodes[handle.index].generation == handle.generation &&
+           nodes[handle.index].callback != nullptr;
+  }
+
+  // Ticks until it fires, 0 if it isn't pending
+  uint64_t Remaining(TimerHandle handle) const {
+    return IsPending(handle) ? nodes[handle.index].expires - now : 0;
+  }
+
+  // Moves one tick forward and fires everything due on it
+  void Advance() {
+    ++now;
+    for (int level = 1; level < TIMER_WHEEL_LEVELS; ++level) {
+      if ((now & ((1ULL << (level * TIMER_WHEEL_SLOT_BITS)) - 1)) != 0) {
+        break;
+      }
+      uint64_t slot = now >> (level * TIMER_WHEEL_SLOT_BITS);
+      Cascade(level, slot & (TIMER_WHEEL_SLOTS - 1));
+    }
+
+    // Detached first, so callbacks scheduling into this slot go around the
+    // wheel instead of being fired again right away
+    uint32_t firing = FiringSentinel();
+    Splice(Sentinel(0, now & (TIMER_WHEEL_SLOTS - 1)), firing);
+    while (nodes[firing].next != firing) {
+      uint32_t index = nodes[firing].next;
+      Unlink(index);
+      if (nodes[index].expires != now) {
+        Link(index);  // Parked past the wheel's range, not due yet
+        continue;
+      }
+      std::function<void()> callback = std::move(nodes[index].callback);
+      Free(index);
+      callback();
+    }
+  }
+
+  size_t Count() const { return count; }
+
+ private:
+  static uint32_t Sentinel(int level, uint64_t slot) {
+    return level * TIMER_WHEEL_SLOTS + slot;
+  }
+
+  static uint32_t FiringSentinel() {
+    return TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS;
+  }
+
+  uint32_t Allocate() {
+    if (freeList != 0) {
+      uint32_t index = freeList;
+      freeList = nodes[index].next;
+      return index;
+    }
+    nodes.emplace_back();
+    return nodes.size() - 1;
+  }
+
+  // Bumping the generation is what makes old handles stop matching
+  void Free(uint32_t index) {
+    nodes[index].callback = nullptr;
+    ++nodes[index].generation;
+    nodes[index].next = freeList;
+    freeList = index;
+    --count;
+  }
+
+  // Puts the timer on the lowest level whose span reaches its expiry
+  void Link(uint32_t index) {
+    uint64_t expires = nodes[index].expires;
+    uint64_t delay = expires - now;
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 &&
+           delay >= (1ULL << ((level + 1) * TIMER_WHEEL_SLOT_BITS))) {
+      ++level;
+    }
+    uint64_t range = 1ULL << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOT_BITS);
+    if (delay >= range) {
+      expires = now + range - 1;
+    }
+    uint64_t slot = (expires >> (level * TIMER_WHEEL_SLOT_BITS)) &
+                    (TIMER_WHEEL_SLOTS - 1);
+
+    uint32_t head = Sentinel(level, slot);
+    Node& node = nodes[index];
+    node.prev = nodes[head].prev;
+    node.next = head;
+    nodes[node.prev].next = index;
+    nodes[head].prev = index;
+  }
+
+  void Unlink(uint32_t index) {
+    Node& node = nodes[index];
+    nodes[node.prev].next = node.next;
+    nodes[node.next].prev = node.prev;
+    node.prev = index;
+    node.next = index;
+  }
+
+  // Moves every node of one list to the empty list at to
+  void Splice(uint32_t from, uint32_t to) {
+    if (nodes[from].next == from) {
+      return;
+    }
+    nodes[to].next = nodes[from].next;
+    nodes[to].prev = nodes[from].prev;
+    nodes[nodes[to].next].prev = to;
+    nodes[nodes[to].prev].next = to;
+    nodes[from].next = from;
+    nodes[from].prev = from;
+  }
+
+  // Redistributes a higher level slot now that its span has come up
+  void Cascade(int level, uint64_t slot) {
+    uint32_t moving = FiringSentinel();
+    Splice(Sentinel(level, slot), moving);
+    while (nodes[moving].next != moving) {
+      uint32_t index = nodes[moving].next;
+      Unlink(index);
+      Link(index);
+    }
+  }
+};
+
+#endif
@@ -3,13 +3,18 @@
 
 #include <raylib.h>
 #include <raymath.h>
+#include <rlgl.h>
 
 #include <cctype>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <string>
 #include <vector>
 
+#include "atlas.hpp"
+#include "renderqueue.hpp"
+
 const int BUTTON_WIDTH_1(260);
 const int BUTTON_HEIGHT_1(60);
 const int FONT_SIZE_1(20);
@@ -18,8 +23,6 @@ const int FONT_SIZE_3(60);
 
 Sound tick;
 
-std::string userName = "";
-
 enum UIState {
 	InMainMenu = 0,
 	InScoreScreen = 1,
@@ -33,12 +36,32 @@ enum UIState {
 //                  UI COMPONENTS
 // --------------------------------------------------
 
+// Components are retained: a menu is only drawn again after something in
+// it calls MarkDirty, see UILibrary::Draw. Anything that changes how a
+// component looks after createUI has to go through a setter that does.
 struct UIComponent {
     Rectangle bounds;
+    UIComponent* parent = nullptr;
+    bool dirty = true;  // only read on the root container
 
     bool isHovered = false;
 
-    virtual void Draw() = 0;
+    void MarkDirty() {
+        for (UIComponent* c = this; c != nullptr; c = c->parent) {
+            c->dirty = true;
+        }
+    }
+
+    // Only changes isHovered, returns whether the mouse is over it
+    bool SetHovered(bool hovered) {
+        if (hovered != isHovered) {
+            isHovered = hovered;
+            MarkDirty();
+        }
+        return hovered;
+    }
+
+    virtual void Submit(RenderQueue& queue) = 0;
 
     virtual bool HandleHover(Vector2 mousePosition) = 0;
 
@@ -50,16 +73,23 @@ struct UIContainer: public UIComponent {
     bool transparent;
     Color containerColor;
 
-    void AddChild(UIComponent* child) { children.push_back(child); }
+    void AddChild(UIComponent* child) {
+        child->parent = this;
+        children.push_back(child);
+        MarkDirty();
+    }
 
-    void ClearChildren() { children.clear(); }
+    void ClearChildren() {
+        children.clear();
+        MarkDirty();
+    }
 
-    void Draw() override {
+    void Submit(RenderQueue& queue) override {
         if (!transparent) {
-            DrawRectangle(bounds.x, bounds.y, bounds.width, bounds.height, containerColor);
+            queue.Rect(LAYER_UI_BACKGROUND, bounds, containerColor);
         }
         for (size_t i = 0; i < children.size(); i++) {
-            children[i]->Draw();
+            children[i]->Submit(queue);
         }
     }
 
@@ -88,11 +118,27 @@ struct UIContainer: public UIComponent {
 //                BACKGROUND IMAGE
 // --------------------------------------------------
 
+// Whether two regions would draw the same pixels, e.g. after a hot reload
+bool SameSprite(const SpriteRegion& a, const SpriteRegion& b) {
+    return a.texture.id == b.texture.id && a.source.x == b.source.x &&
+        a.source.y == b.source.y && a.source.width == b.source.width &&
+        a.source.height == b.source.height;
+}
+
 struct BackgroundImage : public UIComponent {
-    Texture backgroundImageTexture;
+    SpriteRegion backgroundSprite = {0};
+
+    void SetSprite(SpriteRegion sprite) {
+        if (!SameSprite(sprite, backgroundSprite)) {
+            backgroundSprite = sprite;
+            MarkDirty();
+        }
+    }
 
-    void Draw() override {
-        DrawTexture(backgroundImageTexture, bounds.x, bounds.y, WHITE);
+    void Submit(RenderQueue& queue) override {
+        queue.SpriteAt(
+            LAYER_UI_BACKGROUND, backgroundSprite.texture, backgroundSprite.source,
+            {bounds.x, bounds.y});
     }
 
     bool HandleHover(Vector2 mousePosition) override { return false; }
@@ -104,41 +150,67 @@ struct BackgroundImage : public UIComponent {
 //                      BUTTON
 // --------------------------------------------------
 
+// Text is only measured again when it or the bounds change. The cache key
+// is compared in Submit, which only runs when the menu is redrawn.
+struct TextLayout {
+    std::string text;
+    Rectangle bounds = {0, 0, -1, -1};
+    int fontSize = 0;
+    Vector2 size = {0, 0};
+
+    bool IsCurrent(const std::string& t, Rectangle b, int f) const {
+        return t == text && f == fontSize && b.x == bounds.x &&
+            b.y == bounds.y && b.width == bounds.width &&
+            b.height == bounds.height;
+    }
+
+    void Measure(const std::string& t, Rectangle b, int f) {
+        text = t;
+        bounds = b;
+        fontSize = f;
+        size = MeasureTextEx(GetFontDefault(), text.c_str(), fontSize, 1);
+    }
+};
+
 struct Button : public UIComponent {
     std::string text;
     bool active;
+    TextLayout layout;
+    int textX, textY;
     
-    void (*buttonAction)();
+    std::function<void()> buttonAction;
 
-    void Draw() override {
+    void SetActive(bool value) {
+        if (value != active) {
+            active = value;
+            MarkDirty();
+        }
+    }
+
+    void Submit(RenderQueue& queue) override {
         if (isHovered && active) {
-            DrawRectangleRec(bounds, RED);
+            queue.Rect(LAYER_UI_PANELS, bounds, RED);
         } else if (active) {
-            DrawRectangleRec(bounds, GRAY);
+            queue.Rect(LAYER_UI_PANELS, bounds, GRAY);
         } else {
-            DrawRectangleRec(bounds, DARKGRAY);
+            queue.Rect(LAYER_UI_PANELS, bounds, DARKGRAY);
         }
 
-        Vector2 textDimensions = MeasureTextEx(GetFontDefault(), text.c_str(), FONT_SIZE_1, 1);
-
-        int textX = (bounds.x + (bounds.width / 2.1)) - (textDimensions.x / 2);
-        int textY = (bounds.y + (bounds.height / 2)) - (textDimensions.y / 2);
+        if (!layout.IsCurrent(text, bounds, FONT_SIZE_1)) {
+            layout.Measure(text, bounds, FONT_SIZE_1);
+            textX = (bounds.x + (bounds.width / 2.1)) - (layout.size.x / 2);
+            textY = (bounds.y + (bounds.height / 2)) - (layout.size.y / 2);
+        }
 
         if (active) {
-            DrawText(text.c_str(), textX, textY, FONT_SIZE_1, WHITE);
+            queue.Text(LAYER_UI_TEXT, text.c_str(), textX, textY, FONT_SIZE_1, WHITE);
         } else {
-            DrawText(text.c_str(), textX, textY, FONT_SIZE_1, LIGHTGRAY);
+            queue.Text(LAYER_UI_TEXT, text.c_str(), textX, textY, FONT_SIZE_1, LIGHTGRAY);
         }
     }
 
     bool HandleHover(Vector2 mousePosition) override {
-        isHovered = false;
-        if (CheckCollisionPointRec(mousePosition, bounds)) {
-            isHovered = true;
-            return true;
-        } else {
-            return false;
-        }
+        return SetHovered(CheckCollisionPointRec(mousePosition, bounds));
     }
 
     bool HandleClick(Vector2 clickPosition) override {
@@ -163,10 +235,27 @@ struct Label : public UIComponent {
     int fontSize;
     Color textColor;
     bool centerAlign = true, leftAlign = false, rightAlign = false;
+    TextLayout layout;
+    int textX, textY;
 
-    void Draw() override {
-        Vector2 textDimensions = MeasureTextEx(GetFontDefault(), text.c_str(), fontSize, 1);
-        int textX, textY;
+    void SetText(const std::string& value) {
+        if (value != text) {
+            text = value;
+            MarkDirty();
+        }
+    }
+
+    void Submit(RenderQueue& queue) override {
+        if (!layout.IsCurrent(text, bounds, fontSize)) {
+            layout.Measure(text, bounds, fontSize);
+            Align();
+        }
+
+        queue.Text(LAYER_UI_TEXT, text.c_str(), textX, textY, fontSize, textColor);
+    }
+
+    void Align() {
+        Vector2 textDimensions = layout.size;
         if (centerAlign) {
             textX = bounds.x - (textDimensions.x / 2);
             textY = (bounds.y + (bounds.height / 2)) - (textDimensions.y / 2);
@@ -177,26 +266,30 @@ struct Label : public UIComponent {
             textX = bounds.x - textDimensions.x;
             textY = (bounds.y + (bounds.height / 2)) - (textDimensions.y / 2);
         }
-
-        DrawText(text.c_str(), textX, textY, fontSize, textColor);
     }
 
     void setCenterAlign() {
         leftAlign = false;
         rightAlign = false;
         centerAlign = true;
+        Align();
+        MarkDirty();
     }
 
     void setLeftAlign() {
         rightAlign = false;
         centerAlign = false;
         leftAlign = true;
+        Align();
+        MarkDirty();
     }
 
     void setRightAlign() {
         centerAlign = false;
         leftAlign = false;
         rightAlign = true;
+        Align();
+        MarkDirty();
     }
 
     bool HandleHover(Vector2 mousePosition) override { return false; }
@@ -211,12 +304,16 @@ struct TextField : public UIComponent {
     Color textColor;
     bool isMax;
 
-    void Draw() override {
-        if (letterCount == 0) {
-            text[letterCount] = '_';
-        }
-        userName = text;
-        DrawText(text, bounds.x, bounds.y, fontSize, textColor);
+    void Submit(RenderQueue& queue) override {
+        queue.Text(LAYER_UI_TEXT, text, bounds.x, bounds.y, fontSize, textColor);
+    }
+
+    void Clear() {
+        letterCount = 0;
+        isMax = false;
+        text[0] = '_';
+        text[1] = '\0';
+        MarkDirty();
     }
 
     void AddLetter(char letter) {
@@ -233,6 +330,7 @@ struct TextField : public UIComponent {
         }
 
         letterCount += 1;
+        MarkDirty();
     }
 
     void RemoveLetter() {
@@ -244,6 +342,7 @@ struct TextField : public UIComponent {
         text[letterCount] = '_';
         text[letterCount + 1] = '\0';
         isMax = false;
+        MarkDirty();
     }
 
     bool HandleHover(Vector2 mousePosition) override { return false; }
@@ -254,28 +353,45 @@ struct TextField : public UIComponent {
 struct HPBar : public UIComponent {
     int maxHealth;
     int currentHealth;
-    Texture heart_full, heart_half, heart_empty;
+    SpriteRegion heart_full = {0}, heart_half = {0}, heart_empty = {0};
 
-    void Draw() override {
+    void Submit(RenderQueue& queue) override {
         float numHearts = maxHealth / 2;
         for(size_t i = 1; i <= numHearts; i++){
             if(currentHealth >= i * 2) {
-                DrawTextureEx(heart_full, {bounds.x + (i * 50), bounds.y}, 0, 3, WHITE);
+                SubmitHeart(queue, heart_full, i);
             } else if (currentHealth == (i * 2) - 1) {
-                DrawTextureEx(heart_half, {bounds.x + (i * 50), bounds.y}, 0, 3, WHITE);
+                SubmitHeart(queue, heart_half, i);
             } else if (currentHealth < i * 2) {
-                DrawTextureEx(heart_empty, {bounds.x + (i * 50), bounds.y}, 0, 3, WHITE);
+                SubmitHeart(queue, heart_empty, i);
             }
         }
     }
 
+    void SubmitHeart(RenderQueue& queue, SpriteRegion heart, size_t i) {
+        queue.Sprite(
+            LAYER_UI_SPRITES, heart.texture, heart.source,
+            {bounds.x + (i * 50), bounds.y, heart.source.width * 3, heart.source.height * 3});
+    }
+
+    void SetHearts(SpriteRegion full, SpriteRegion half, SpriteRegion empty) {
+        if (!SameSprite(full, heart_full) || !SameSprite(half, heart_half) ||
+            !SameSprite(empty, heart_empty)) {
+            heart_full = full;
+            heart_half = half;
+            heart_empty = empty;
+            MarkDirty();
+        }
+    }
+
     void InitBar(int value) {
         maxHealth = value;
         currentHealth = maxHealth;
+        MarkDirty();
     }
 
     void UpdateHealth(int value) {
-        std::cout << value << std::endl;
+        int previousHealth = currentHealth;
         if (value > maxHealth) {
             currentHealth = maxHealth;
         } else if (value <= 0) {
@@ -283,6 +399,9 @@ struct HPBar : public UIComponent {
         } else {
             currentHealth = value;
         }
+        if (currentHealth != previousHealth) {
+            MarkDirty();
+        }
     }
     
 
@@ -291,8 +410,13 @@ struct HPBar : public UIComponent {
     bool HandleClick(Vector2 clickPosition) override { return false; }
 };
 
+// Draws the tree into a render texture only when something in it changed,
+// and otherwise just puts last frame's texture back on screen
 struct UILibrary {
     UIContainer rootContainer;
+    RenderQueue renderQueue;
+    RenderTexture2D cache = {0};
+    int redrawCount = 0;
 
     void Update() {
         rootContainer.HandleHover(GetMousePosition());
@@ -302,7 +426,52 @@ struct UILibrary {
         }
     }
 
-    void Draw() { rootContainer.Draw(); }
+    void Draw() {
+        Rectangle area = rootContainer.bounds;
+        if (cache.id == 0 || cache.texture.width != (int)area.width ||
+            cache.texture.height != (int)area.height) {
+            Unload();
+            cache = LoadRenderTexture(area.width, area.height);
+            rootContainer.dirty = true;
+        }
+
+        if (rootContainer.dirty) {
+            Camera2D toCache = {{-area.x, -area.y}, {0, 0}, 0, 1};
+            BeginTextureMode(cache);
+            ClearBackground(BLANK);
+            // Colors are blended as usual, which leaves them multiplied by
+            // alpha over the clear, but alpha itself is added up as coverage
+            // rather than blended with itself
+            rlSetBlendFactorsSeparate(
+                RL_SRC_ALPHA, RL_ONE_MINUS_SRC_ALPHA, RL_ONE,
+                RL_ONE_MINUS_SRC_ALPHA, RL_FUNC_ADD, RL_FUNC_ADD);
+            BeginBlendMode(BLEND_CUSTOM_SEPARATE);
+            BeginMode2D(toCache);
+            rootContainer.Submit(renderQueue);
+            renderQueue.Flush();
+            EndMode2D();
+            EndBlendMode();
+            EndTextureMode();
+            rootContainer.dirty = false;
+            redrawCount++;
+        }
+
+        // Render textures are stored upside down. The cache holds colors
+        // multiplied by alpha and plain alpha, so it goes on premultiplied.
+        BeginBlendMode(BLEND_ALPHA_PREMULTIPLY);
+        DrawTextureRec(
+            cache.texture, {0, 0, area.width, -area.height}, {area.x, area.y},
+            WHITE);
+        EndBlendMode();
+    }
+
+    // Needs the window, so has to run before CloseWindow
+    void Unload() {
+        if (cache.id != 0) {
+            UnloadRenderTexture(cache);
+            cache = {0};
+        }
+    }
 };
 
 
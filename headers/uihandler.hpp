@@ -10,94 +10,38 @@
 #include <string>
 #include <vector>
 
+#include "leaderboard.hpp"
 #include "uicomponents.hpp"
 
-UIState currentGameState = InMainMenu;
+Leaderboard leaderboard;
 
-void startGame() { currentGameState = InGame; };
-void goToMainMenu() { currentGameState = InMainMenu; };
-void goToScoreScreen() { currentGameState = InScoreScreen; };
-void goToPauseScreen() { currentGameState = InPauseScreen; };
-void goToGameOverScreen() { currentGameState = InGameOverScreen; };
-void exitGame() { exit(1); };
-
-int num_of_scores = 0;
-int max_score = 0;
-int min_score = 0;
-int newScore = 0;
-int health = 0;
-
-bool scoreUpdate = false;
+void exitGame() {
+    leaderboard.Stop();
+    exit(1);
+};
 
 // --------------------------------------------------
 //                  MENU BUILDING
 // --------------------------------------------------
 
-void saveScore() {
-    std::fstream highScoreFile;
-    std::ofstream newHighScoreFile;
-    int currentScore;
-    bool addedNewScore = false;
-    std::vector<std::string> scoreList;
-
-    highScoreFile.open("high_scores.txt");
-    std::string line;
-    float scoreNumber = 1;
-
-    std::string newScoreLine = std::to_string(newScore) + " " + userName;
-
-    while (getline(highScoreFile, line) && scoreList.size() < 10) {
-        int end = line.find(" ");
-        std::string score = line.substr(0, end - 0);
-        std::string name = line.substr(end, line.length());
-
-        currentScore = stoi(score);
-
-        if (!addedNewScore) {
-        if (newScore <= currentScore) {
-            scoreList.push_back(line);
-        } else {
-            scoreList.push_back(newScoreLine);
-            if (scoreList.size() >= 10) break;
-            scoreList.push_back(line);
-            addedNewScore = true;
-        }
-        } else {
-        scoreList.push_back(line);
-        }
-    }
-
-    if (!addedNewScore && scoreList.size() < 10) {
-        scoreList.push_back(newScoreLine);
-    }
-
-    highScoreFile.close();
-
-    newHighScoreFile.open("high_scores.txt", std::ofstream::trunc);
-
-    for (size_t i = 0; i < scoreList.size(); i++) {
-        newHighScoreFile << scoreList[i] << std::endl;
-    }
-
-    newHighScoreFile.close();
-
-    scoreUpdate = true;
-
-    currentGameState = InScoreScreen;
-};
-
 struct Menu {
     UILibrary uiLibrary;
+    UIState* state = nullptr;  // the MenuHandler's, set before createUI
+
+    // A button action that switches to another menu
+    std::function<void()> GoTo(UIState next) {
+        return [this, next] { *state = next; };
+    }
 
     virtual void createUI(float windowWidth, float windowHeight) = 0;
 
     virtual void Update() = 0;
 
-    virtual void loadBackgroundTexture(Texture tex) = 0;
-
-    virtual void unloadBackgroundTexture() = 0;
+    virtual void loadBackgroundSprite(SpriteRegion sprite) = 0;
 
     void Draw() { uiLibrary.Draw(); }
+
+    void Unload() { uiLibrary.Unload(); }
 };
 
 struct MainMenu : public Menu {
@@ -116,7 +60,7 @@ struct MainMenu : public Menu {
         startGameButton.bounds = {
         windowWidth / 2 - BUTTON_WIDTH_1 / 2,
         windowHeight / 2 - BUTTON_HEIGHT_1 / 2, BUTTON_WIDTH_1, BUTTON_HEIGHT_1};
-        startGameButton.buttonAction = startGame;
+        startGameButton.buttonAction = GoTo(InGame);
         startGameButton.active = true;
         uiLibrary.rootContainer.AddChild(&startGameButton);
 
@@ -124,31 +68,27 @@ struct MainMenu : public Menu {
         checkHighScoresButton.bounds = {
         windowWidth / 2 - BUTTON_WIDTH_1 / 2, windowHeight / 2 + BUTTON_HEIGHT_1,
         BUTTON_WIDTH_1, BUTTON_HEIGHT_1};
-        checkHighScoresButton.buttonAction = goToScoreScreen;
+        checkHighScoresButton.buttonAction = GoTo(InScoreScreen);
         checkHighScoresButton.active = true;
         uiLibrary.rootContainer.AddChild(&checkHighScoresButton);
     }
 
-    void loadBackgroundTexture(Texture tex) override {
-        startMenuBackground.backgroundImageTexture = tex;
-    }
-
-    void unloadBackgroundTexture() override {
-        UnloadTexture(startMenuBackground.backgroundImageTexture);
+    void loadBackgroundSprite(SpriteRegion sprite) override {
+        startMenuBackground.SetSprite(sprite);
     }
 
     void Update() override { uiLibrary.Update(); }
 };
 
-struct ScoreScreen : public Menu {
+// High score table shared by both score screens. The rows are built once
+// and only the ones below a new entry have their text replaced.
+struct ScoreBoardMenu : public Menu {
     Label highScoreLabel;
-    Label* scoreLabel;
-    Label* nameLabel;
+    Label scoreLabels[LEADERBOARD_SIZE];
+    Label nameLabels[LEADERBOARD_SIZE];
     Button returnToMainMenuButton;
-    std::fstream highScoreFile;
-    int currentScore;
 
-    void createUI(float windowWidth, float windowHeight) override {
+    void createScoreBoard(float windowWidth, float windowHeight) {
         uiLibrary.rootContainer.ClearChildren();
 
         uiLibrary.rootContainer.bounds = {0, 0, windowWidth, windowHeight};
@@ -163,145 +103,66 @@ struct ScoreScreen : public Menu {
 
         uiLibrary.rootContainer.AddChild(&highScoreLabel);
 
-        highScoreFile.open("high_scores.txt");
-        std::string line;
-        float scoreNumber = 1;
-        while (getline(highScoreFile, line)) {
-        std::cout << line << std::endl;
-        int end = line.find(" ");
-        std::string score = line.substr(0, end - 0);
-        std::string name = line.substr(end, line.length());
-
-        currentScore = stoi(score);
+        for (int i = 0; i < LEADERBOARD_SIZE; i++) {
+        float scoreNumber = i + 1;
 
-        if (scoreNumber == 1) {
-            max_score = currentScore;
-        }
-
-        scoreLabel = new Label;
-        scoreLabel->text = score;
-        scoreLabel->bounds = {
+        scoreLabels[i].bounds = {
             windowWidth / 2 - 20, (FONT_SIZE_3 * 3) + (FONT_SIZE_2 * scoreNumber),
             0, FONT_SIZE_2};
-        scoreLabel->fontSize = FONT_SIZE_2;
-        scoreLabel->setRightAlign();
-        scoreLabel->textColor = BLACK;
+        scoreLabels[i].fontSize = FONT_SIZE_2;
+        scoreLabels[i].setRightAlign();
+        scoreLabels[i].textColor = BLACK;
 
-        nameLabel = new Label;
-        nameLabel->text = name;
-        nameLabel->bounds = {
+        nameLabels[i].bounds = {
             windowWidth / 2 + 10, (FONT_SIZE_3 * 3) + (FONT_SIZE_2 * scoreNumber),
             0, FONT_SIZE_2};
-        nameLabel->fontSize = FONT_SIZE_2;
-        nameLabel->setLeftAlign();
-        nameLabel->textColor = BLACK;
-
-        uiLibrary.rootContainer.AddChild(scoreLabel);
-        uiLibrary.rootContainer.AddChild(nameLabel);
+        nameLabels[i].fontSize = FONT_SIZE_2;
+        nameLabels[i].setLeftAlign();
+        nameLabels[i].textColor = BLACK;
 
-        num_of_scores += 1;
-        scoreNumber += 1;
+        uiLibrary.rootContainer.AddChild(&scoreLabels[i]);
+        uiLibrary.rootContainer.AddChild(&nameLabels[i]);
         }
+        RefreshRows(0);
 
-        min_score = currentScore;
-        highScoreFile.close();
-
-        returnToMainMenuButton.text = "MAIN MENU";
         returnToMainMenuButton.bounds = {
         windowWidth / 2 - BUTTON_WIDTH_1 / 2, windowHeight - BUTTON_HEIGHT_1 * 2,
         BUTTON_WIDTH_1, BUTTON_HEIGHT_1};
-        returnToMainMenuButton.buttonAction = goToMainMenu;
         returnToMainMenuButton.active = true;
         uiLibrary.rootContainer.AddChild(&returnToMainMenuButton);
     }
 
-    void loadBackgroundTexture(Texture tex) override {}
+    void RefreshRows(int firstRow) {
+        for (int i = firstRow; i < LEADERBOARD_SIZE; i++) {
+        if (i < (int)leaderboard.entries.size()) {
+            scoreLabels[i].SetText(std::to_string(leaderboard.entries[i].score));
+            nameLabels[i].SetText(" " + leaderboard.entries[i].name);
+        } else {
+            scoreLabels[i].SetText("");
+            nameLabels[i].SetText("");
+        }
+        }
+    }
 
-    void unloadBackgroundTexture() override {}
+    void loadBackgroundSprite(SpriteRegion sprite) override {}
 
     void Update() override { uiLibrary.Update(); }
 };
 
-struct ScoreScreen2 : public Menu {
-    Label highScoreLabel;
-    Label* scoreLabel;
-    Label* nameLabel;
-    Button returnToMainMenuButton;
-    std::fstream highScoreFile;
-    int currentScore;
-
+struct ScoreScreen : public ScoreBoardMenu {
     void createUI(float windowWidth, float windowHeight) override {
-        uiLibrary.rootContainer.ClearChildren();
-
-        uiLibrary.rootContainer.bounds = {0, 0, windowWidth, windowHeight};
-        uiLibrary.rootContainer.transparent = false;
-        uiLibrary.rootContainer.containerColor = WHITE;
-
-        highScoreLabel.text = "HIGH SCORES";
-        highScoreLabel.bounds = {windowWidth / 2, FONT_SIZE_3 * 2, 0, FONT_SIZE_3};
-        highScoreLabel.fontSize = FONT_SIZE_3;
-        highScoreLabel.setCenterAlign();
-        highScoreLabel.textColor = BLACK;
-
-        uiLibrary.rootContainer.AddChild(&highScoreLabel);
-
-        highScoreFile.open("high_scores.txt");
-        std::string line;
-        float scoreNumber = 1;
-        while (getline(highScoreFile, line)) {
-        std::cout << line << std::endl;
-        int end = line.find(" ");
-        std::string score = line.substr(0, end - 0);
-        std::string name = line.substr(end, line.length());
-
-        currentScore = stoi(score);
-
-        if (scoreNumber == 1) {
-            max_score = currentScore;
-        }
-
-        scoreLabel = new Label;
-        scoreLabel->text = score;
-        scoreLabel->bounds = {
-            windowWidth / 2 - 20, (FONT_SIZE_3 * 3) + (FONT_SIZE_2 * scoreNumber),
-            0, FONT_SIZE_2};
-        scoreLabel->fontSize = FONT_SIZE_2;
-        scoreLabel->setRightAlign();
-        scoreLabel->textColor = BLACK;
-
-        nameLabel = new Label;
-        nameLabel->text = name;
-        nameLabel->bounds = {
-            windowWidth / 2 + 10, (FONT_SIZE_3 * 3) + (FONT_SIZE_2 * scoreNumber),
-            0, FONT_SIZE_2};
-        nameLabel->fontSize = FONT_SIZE_2;
-        nameLabel->setLeftAlign();
-        nameLabel->textColor = BLACK;
-
-        uiLibrary.rootContainer.AddChild(scoreLabel);
-        uiLibrary.rootContainer.AddChild(nameLabel);
-
-        num_of_scores += 1;
-        scoreNumber += 1;
-        }
-
-        min_score = currentScore;
-        highScoreFile.close();
+        createScoreBoard(windowWidth, windowHeight);
+        returnToMainMenuButton.text = "MAIN MENU";
+        returnToMainMenuButton.buttonAction = GoTo(InMainMenu);
+    }
+};
 
+struct ScoreScreen2 : public ScoreBoardMenu {
+    void createUI(float windowWidth, float windowHeight) override {
+        createScoreBoard(windowWidth, windowHeight);
         returnToMainMenuButton.text = "QUIT GAME";
-        returnToMainMenuButton.bounds = {
-        windowWidth / 2 - BUTTON_WIDTH_1 / 2, windowHeight - BUTTON_HEIGHT_1 * 2,
-        BUTTON_WIDTH_1, BUTTON_HEIGHT_1};
         returnToMainMenuButton.buttonAction = exitGame;
-        returnToMainMenuButton.active = true;
-        uiLibrary.rootContainer.AddChild(&returnToMainMenuButton);
     }
-
-    void loadBackgroundTexture(Texture tex) override {}
-
-    void unloadBackgroundTexture() override {}
-
-    void Update() override { uiLibrary.Update(); }
 };
 
 struct PauseScreen : Menu {
@@ -324,7 +185,7 @@ struct PauseScreen : Menu {
         returnToMainMenuButton.bounds = {
         (windowWidth / 2 - BUTTON_WIDTH_1 / 2) - (BUTTON_WIDTH_1 * float(0.75)),
         windowHeight / 2 - BUTTON_HEIGHT_1 / 2, BUTTON_WIDTH_1, BUTTON_HEIGHT_1};
-        returnToMainMenuButton.buttonAction = goToMainMenu;
+        returnToMainMenuButton.buttonAction = GoTo(InMainMenu);
         returnToMainMenuButton.active = true;
         uiLibrary.rootContainer.AddChild(&returnToMainMenuButton);
 
@@ -332,14 +193,12 @@ struct PauseScreen : Menu {
         returnToGameButton.bounds = {
         (windowWidth / 2 - BUTTON_WIDTH_1 / 2) + (BUTTON_WIDTH_1 * float(0.75)),
         windowHeight / 2 - BUTTON_HEIGHT_1 / 2, BUTTON_WIDTH_1, BUTTON_HEIGHT_1};
-        returnToGameButton.buttonAction = startGame;
+        returnToGameButton.buttonAction = GoTo(InGame);
         returnToGameButton.active = true;
         uiLibrary.rootContainer.AddChild(&returnToGameButton);
     }
 
-    void loadBackgroundTexture(Texture tex) override {}
-
-    void unloadBackgroundTexture() override {}
+    void loadBackgroundSprite(SpriteRegion sprite) override {}
 
     void Update() override { uiLibrary.Update(); }
 };
@@ -349,6 +208,13 @@ struct GameOverScreen : Menu {
     Button returnToMainMenuButton, saveScoreButton;
     TextField playerName;
     BackgroundImage gameOverBackground;
+    int score = 0;  // of the run that just ended
+
+    void ShowScore(int _score) {
+        score = _score;
+        scoreLabel.SetText("SCORE: " + std::to_string(score));
+        playerName.Clear();
+    }
 
     void createUI(float windowWidth, float windowHeight) override {
         uiLibrary.rootContainer.ClearChildren();
@@ -393,8 +259,7 @@ struct GameOverScreen : Menu {
         FONT_SIZE_2};
         playerName.fontSize = FONT_SIZE_2;
         playerName.textColor = WHITE;
-        playerName.letterCount = 0;
-        playerName.isMax = false;
+        playerName.Clear();
 
         uiLibrary.rootContainer.AddChild(&playerName);
 
@@ -402,7 +267,10 @@ struct GameOverScreen : Menu {
         saveScoreButton.bounds = {
         windowWidth / 2 - BUTTON_WIDTH_1 / 2,
         windowHeight / 2 - BUTTON_HEIGHT_1 / 2, BUTTON_WIDTH_1, BUTTON_HEIGHT_1};
-        saveScoreButton.buttonAction = saveScore;
+        saveScoreButton.buttonAction = [this] {
+            leaderboard.Insert(score, playerName.text);
+            *state = InScoreScreen;
+        };
         saveScoreButton.active = false;
         uiLibrary.rootContainer.AddChild(&saveScoreButton);
 
@@ -415,20 +283,14 @@ struct GameOverScreen : Menu {
         uiLibrary.rootContainer.AddChild(&returnToMainMenuButton);
     }
 
-    void loadBackgroundTexture(Texture tex) override {
-        gameOverBackground.backgroundImageTexture = tex;
+    void loadBackgroundSprite(SpriteRegion sprite) override {
+        gameOverBackground.SetSprite(sprite);
     }
 
-    void unloadBackgroundTexture() override {}
-
     void Update() {
         uiLibrary.Update();
 
-        if (playerName.isMax) {
-        saveScoreButton.active = true;
-        } else {
-        saveScoreButton.active = false;
-        }
+        saveScoreButton.SetActive(playerName.isMax);
 
         int key = GetCharPressed();
         if ((key >= 32) && (key <= 125) && (playerName.letterCount < 3)) {
@@ -445,6 +307,8 @@ struct GameOverScreen : Menu {
 struct HPAndScoreGUI : Menu {
         Label healthLabel, scoreLabel, scoreOutput;
         HPBar hpBar;
+        int score = 0;
+        int shownScore = 0;
         
         void createUI(float windowWidth, float windowHeight) override {
             uiLibrary.rootContainer.bounds = {0, 0, windowWidth, 100};
@@ -473,6 +337,7 @@ struct HPAndScoreGUI : Menu {
             uiLibrary.rootContainer.AddChild(&scoreLabel);
 
             scoreOutput.text = "0";
+            shownScore = 0;
             scoreOutput.bounds = {
             1050, 25, 0, FONT_SIZE_3};
             scoreOutput.fontSize = FONT_SIZE_3;
@@ -481,13 +346,14 @@ struct HPAndScoreGUI : Menu {
             uiLibrary.rootContainer.AddChild(&scoreOutput);
         }
 
-        void loadBackgroundTexture(Texture tex) override {}
-
-        void unloadBackgroundTexture() override {}
+        void loadBackgroundSprite(SpriteRegion sprite) override {}
 
         void Update() override { 
             uiLibrary.Update(); 
-            scoreOutput.text = std::to_string(newScore);
+            if (score != shownScore) {
+                scoreOutput.SetText(std::to_string(score));
+                shownScore = score;
+            }
         }
 };
 
@@ -501,19 +367,14 @@ struct MenuHandler {
     HPAndScoreGUI inGameGUI;
     ScoreScreen2 scoreScreen2;
     float menuWindowWidth, menuWindowHeight;
+    UIState state = InMainMenu;
 
     void initialize(float windowWidth, float windowHeight) {
         menuWindowWidth = windowWidth;
         menuWindowHeight = windowHeight;
 
-        mainMenu.createUI(windowWidth, windowHeight);
-        scoreScreen.createUI(windowWidth, windowHeight);
-        pauseScreen.createUI(windowWidth, windowHeight);
-        gameOverScreen.createUI(windowWidth, windowHeight);
-        inGameGUI.createUI(windowWidth, windowHeight);
-        scoreScreen2.createUI(windowWidth, windowHeight);
-
-        currentGameState = InMainMenu;
+        leaderboard.Load(SCORE_LOG_FILENAME, SCORE_INDEX_FILENAME);
+        leaderboard.TakeChangedRow();  // the score screens start from it
 
         menuList.push_back(&mainMenu);
         menuList.push_back(&scoreScreen);
@@ -521,26 +382,45 @@ struct MenuHandler {
         menuList.push_back(&gameOverScreen);
         menuList.push_back(&inGameGUI);
         menuList.push_back(&scoreScreen2);
+        for (Menu* menu : menuList) {
+            menu->state = &state;
+        }
+
+        mainMenu.createUI(windowWidth, windowHeight);
+        scoreScreen.createUI(windowWidth, windowHeight);
+        pauseScreen.createUI(windowWidth, windowHeight);
+        gameOverScreen.createUI(windowWidth, windowHeight);
+        inGameGUI.createUI(windowWidth, windowHeight);
+        scoreScreen2.createUI(windowWidth, windowHeight);
+
+        state = InMainMenu;
     }
 
     void Update() {
-        //if (currentGameState == InGame) return;
-        if (scoreUpdate) {
-            scoreScreen.createUI(menuWindowWidth, menuWindowHeight);
-            scoreUpdate = false;
+        //if (state == InGame) return;
+        int changedRow = leaderboard.TakeChangedRow();
+        if (changedRow >= 0) {
+            scoreScreen.RefreshRows(changedRow);
+            scoreScreen2.RefreshRows(changedRow);
         }
 
-        menuList[currentGameState]->Update();
+        menuList[state]->Update();
     }
 
     void Draw() {
-        //if (currentGameState == InGame) return;
-        menuList[currentGameState]->Draw();
+        //if (state == InGame) return;
+        menuList[state]->Draw();
+    }
+
+    void Unload() {
+        for (Menu* menu : menuList) {
+            menu->Unload();
+        }
     }
 
-    void setState(UIState s) { currentGameState = s; }
+    void setState(UIState s) { state = s; }
 
-    UIState getState() { return currentGameState; }
+    UIState getState() { return state; }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,678 @@
+#ifndef WORLD
+#define WORLD
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <iostream>
+#include <list>
+#include <vector>
+
+#include "behavior.hpp"
+#include "broadphase.hpp"
+#include "camera.hpp"
+#include "enemies.hpp"
+#include "input.hpp"
+#include "level.hpp"
+#include "properties.hpp"
+#include "random.hpp"
+#include "simlod.hpp"
+#include "snapshot.hpp"
+#include "timerwheel.hpp"
+
+const char* LEVEL_FILENAME("level.cfg");
+const char* PROPERTIES_FILENAME("properties.cfg");
+
+const uint32_t WORLD_SEED(0x9E3779B9);
+
+const int TICKS_PER_SECOND(60);
+const float TIMESTEP(1.0f / (float)TICKS_PER_SECOND);
+
+// What the camera shows, in screen pixels. Enemies near it are simulated at
+// full rate, so the camera is part of the simulation.
+const float VIEW_WIDTH(1280);
+const float VIEW_HEIGHT(720);
+const float VIEW_ZOOM(1.3f);
+
+const float START_TIME(30.0f);  // in seconds
+const float ATTACK_ANIMATION_LENGTH(0.15f);
+const float SWING_COOLDOWN(.75f);
+const Rectangle BULLET_LIMITS({0, 0, 1200, 1200});
+
+// Wave pacing. Every KILLS_PER_WAVE kills another wave joins, the melee
+// enemies speed up and the swing cooldown gets shorter.
+const int KILLS_PER_WAVE(10);
+const float WAVE_SPEED_UP(0.025f);
+const float WAVE_SWING_BUFF(0.05f);  // seconds
+const int POINTS_PER_KILL(10);
+
+const Vector2 ENEMY_HALF_SIZES({20, 20});
+const Vector2 ITEM_HALF_SIZES({20, 20});
+const Vector2 WEAPON_HALF_SIZES({40, 60});
+// The first MELEE_ENEMIES_AT_START are out from the start, the rest join
+// one per wave in this order
+const Vector2 MELEE_ENEMY_SPAWNS[] = {
+  {500, 200}, {500, 400}, {200, 500}, {600, 420}, {400, 120},
+  {300, 120}, {800, 280}, {200, 1000}, {800, 120},
+};
+const int MELEE_ENEMY_SPAWN_COUNT(9);
+const int MELEE_ENEMIES_AT_START(3);
+// Two more come with every wave
+const Vector2 RANGED_ENEMY_SPAWNS[] = {{300, 400}, {900, 400}};
+const int RANGED_ENEMY_SPAWN_COUNT(2);
+
+// Rounded to whole fixed timesteps, for the timer wheel
+uint64_t SecondsToTicks(float seconds) {
+  return seconds > 0 ? (uint64_t)roundf(seconds / TIMESTEP) : 0;
+}
+
+// Tuning that stays the same for a whole game, the defaults are the game's
+struct WavePacing {
+  int killsPerWave = KILLS_PER_WAVE;
+  float speedUp = WAVE_SPEED_UP;
+  float swingBuff = WAVE_SWING_BUFF;
+};
+
+// What a tick did that the game shows or plays. The simulation never reads
+// these back.
+struct TickEvents {
+  bool swung = false;
+  std::vector<Vector2> kills;  // where enemies were killed
+
+  void Clear() {
+    swung = false;
+    kills.clear();
+  }
+};
+
+// Everything the simulation changes while playing, apart from the level
+// layout: the player, the enemies and their behaviors, bullets, items,
+// platform progress, the gameplay timers, the camera and the randomness.
+// Tick runs one fixed timestep of it, so with the same input the same
+// world always ends up in the same state.
+//
+// The world can be saved into a WorldSnapshot at any point between ticks
+// and put back exactly as it was. Behaviors keep what they remember in
+// their enemy, and timers are saved as ticks left, so restoring stops
+// every behavior and timer and starts them again from the saved state.
+// Entities already allocated are reused.
+//
+// Worlds share nothing, any number of them can run side by side on
+// different threads.
+struct World {
+  Level* level;  // owned by the world, along with everything in it
+  const Properties* properties;
+  Player* player;
+  PlayerWeapon* weapon;
+  std::list<MeleeEnemy*> activeMeleeEnemies;    // both kept in the order of
+  std::list<MeleeEnemy*> inactiveMeleeEnemies;  // level->meleeEnemies
+
+  TimerWheel timers;
+  BehaviorScheduler brain;  // enemy decisions
+  SweepAndPrune crowd;      // keeps enemies from piling up inside each other
+  GameRandom random;
+  InputBuffer input;  // read by the player
+  Camera2D camera;
+  SimulationScheduler simScheduler;
+  TickEvents events;  // of the last tick
+  WavePacing pacing;
+  std::ostream* log = &std::cout;  // what happens in the game, or nullptr
+
+  bool inAttackAnimation = false;
+  bool canSwing = true;
+  float swingCooldownBuff = 0.0f;
+  uint64_t startTick = 0;
+  TimerHandle attackAnimationTimer;
+  TimerHandle swingCooldownTimer;
+  TimerHandle waveTimer;
+
+  World(
+    Level* _level, const Properties* _properties, uint32_t seed = WORLD_SEED,
+    WavePacing _pacing = WavePacing()
+  )
+      : level(_level),
+        properties(_properties),
+        player(_level->player),
+        brain(timers, _level->player),
+        pacing(_pacing) {
+    random.state = seed != 0 ? seed : WORLD_SEED;
+    player->input = &input;
+    camera = {0};
+    camera.target = player->position;
+    camera.offset = {VIEW_WIDTH / 2, VIEW_HEIGHT / 2};
+    camera.zoom = VIEW_ZOOM;
+    weapon = new PlayerWeapon(player->position, WEAPON_HALF_SIZES);
+
+    for (int i = 0; i < MELEE_ENEMY_SPAWN_COUNT; ++i) {
+      MeleeEnemy* m = new MeleeEnemy(MELEE_ENEMY_SPAWNS[i], ENEMY_HALF_SIZES);
+      m->random.state = random.Next();
+      level->meleeEnemies.push_back(m);
+      if (i < MELEE_ENEMIES_AT_START) {
+        activeMeleeEnemies.push_back(m);
+      } else {
+        inactiveMeleeEnemies.push_back(m);
+      }
+    }
+    for (MeleeEnemy* m : activeMeleeEnemies) {
+      crowd.Insert(m);
+      StartPatrol(m);
+    }
+    for (int i = 0; i < RANGED_ENEMY_SPAWN_COUNT; ++i) {
+      AddRangedEnemy(RANGED_ENEMY_SPAWNS[i]);
+    }
+  }
+
+  World(const World&) = delete;
+  World& operator=(const World&) = delete;
+
+  ~World() {
+    for (MeleeEnemy* m : level->meleeEnemies) {
+      delete m;
+    }
+    for (RangedEnemy* r : level->rangedEnemies) {
+      delete r;
+    }
+    for (Bullet* b : level->bullets) {
+      delete b;
+    }
+    for (Item* i : level->items) {
+      delete i;
+    }
+    for (Obstacle* o : level->obstacles) {
+      delete o;
+    }
+    delete player;
+    delete level;
+    delete weapon;
+  }
+
+  // Ticks since the game started
+  uint64_t Elapsed() const { return timers.now - startTick; }
+
+  int Score() const { return player->kills * POINTS_PER_KILL; }
+
+  // New randomness from here on for the world and every enemy, the same
+  // way the constructor seeds them. For playing one recording with
+  // different luck.
+  void Reseed(uint32_t seed) {
+    random.state = seed != 0 ? seed : WORLD_SEED;
+    for (MeleeEnemy* m : level->meleeEnemies) {
+      m->random.state = random.Next();
+    }
+    for (RangedEnemy* r : level->rangedEnemies) {
+      r->random.state = random.Next();
+    }
+  }
+
+  // One fixed timestep. Give input its edges for the tick first, see
+  // InputBuffer::BeginTick.
+  void Tick() {
+    events.Clear();
+    timers.Advance();
+    brain.Sense();
+    simScheduler.Begin(GetCameraBounds(camera, VIEW_WIDTH, VIEW_HEIGHT));
+
+    // Player Movement
+    player->MoveHorizontal(properties);
+    player->CollideHorizontal(level->obstacles, properties->gap);
+    player->MoveVertical(properties);
+    player->CollideVertical(level->obstacles, properties->gap);
+
+    weapon->Update(player, level->bullets);
+
+    // Attacking
+    if (canSwing && input.Consume(ACTION_ATTACK, ATTACK_BUFFER_TIME)) {
+      Swing();
+    }
+
+    level->Update(BULLET_LIMITS, TIMESTEP);
+    for (size_t i = 0; i < level->bullets.size();) {
+      Bullet* b = level->bullets[i];
+      bool hitPlayer = b->CollidePlayer(player);
+      if (hitPlayer) {
+        player->health -= 1;
+      }
+      if (hitPlayer || b->IsOutsideLimits(BULLET_LIMITS)) {
+        level->bullets.erase(level->bullets.begin() + i);
+        delete b;
+      } else {
+        ++i;
+      }
+    }
+
+    for (size_t i = 0; i < level->rangedEnemies.size();) {
+      RangedEnemy* r = level->rangedEnemies[i];
+      if (simScheduler.Schedule(r)) {
+        r->Update(properties, level->obstacles);
+      }
+      if (r->CollidePlayer(player)) {
+        player->health -= 1;
+        level->rangedEnemies.erase(level->rangedEnemies.begin() + i);
+        crowd.Remove(r);
+        delete r;
+      } else {
+        ++i;
+      }
+    }
+
+    float timeLeft = START_TIME - Elapsed() * TIMESTEP;
+    if (!level->items.empty() && level->items[0]->Update(player, timeLeft)) {
+      delete level->items[0];
+      level->items.clear();
+    }
+
+    // Enemy Movement
+    for (auto const& i : activeMeleeEnemies) {
+      if (simScheduler.Schedule(i) &&
+          i->Update(properties, level->obstacles, player) && log != nullptr) {
+        *log << "Health: " << player->health << std::endl;
+      }
+    }
+    crowd.Update();
+    crowd.Separate(level->obstacles);
+
+    FollowPlayer();
+  }
+
+  void StartPatrol(MeleeEnemy* m) {
+    m->behavior = m->Patrol(brain, player);
+    m->behavior.Start();
+  }
+
+  void StartShooter(RangedEnemy* r) {
+    r->behavior = r->Shooter(brain, player, level->bullets);
+    r->behavior.Start();
+  }
+
+  void ScheduleAttackAnimationEnd(uint64_t ticks) {
+    timers.Cancel(attackAnimationTimer);
+    attackAnimationTimer =
+      timers.Schedule(ticks, [this] { inAttackAnimation = false; });
+  }
+
+  void ScheduleSwingCooldownEnd(uint64_t ticks) {
+    timers.Cancel(swingCooldownTimer);
+    swingCooldownTimer = timers.Schedule(ticks, [this] { canSwing = true; });
+  }
+
+  void ScheduleWave(uint64_t ticks) {
+    timers.Cancel(waveTimer);
+    waveTimer = timers.Schedule(ticks, [this] { SpawnWave(); });
+  }
+
+  // An item if there is none, two ranged enemies and the next melee enemy
+  void SpawnWave() {
+    if (level->items.empty()) {
+      int itemSpawnIndex = random.Below(level->itemSpawns.size());
+      Item* newItem =
+        new Item(level->itemSpawns[itemSpawnIndex], ITEM_HALF_SIZES);
+      level->items.push_back(newItem);
+    }
+    for (int i = 0; i < RANGED_ENEMY_SPAWN_COUNT; ++i) {
+      AddRangedEnemy(RANGED_ENEMY_SPAWNS[i]);
+    }
+
+    if (inactiveMeleeEnemies.size() > 0) {
+      crowd.Insert(inactiveMeleeEnemies.front());
+      StartPatrol(inactiveMeleeEnemies.front());
+      activeMeleeEnemies.push_back(inactiveMeleeEnemies.front());
+      inactiveMeleeEnemies.pop_front();
+      if (log != nullptr) {
+        *log << "ADDED 1 ENEMY" << std::endl;
+      }
+    }
+    for (auto const& i : activeMeleeEnemies) {
+      i->speedModifier += pacing.speedUp;
+    }
+
+    swingCooldownBuff += pacing.swingBuff;
+    if (log != nullptr) {
+      *log << "Added " << pacing.speedUp << " speed" << std::endl;
+    }
+    player->killsThreshold = 0;
+  }
+
+  void Snapshot(WorldSnapshot& into) const {
+    into.Clear();
+    into.Write(WorldRecord{
+      .elapsed = Elapsed(),
+      .random = random.state,
+      .swingCooldownBuff = swingCooldownBuff,
+      .attackAnimationIn = (uint32_t)timers.Remaining(attackAnimationTimer),
+      .swingCooldownIn = (uint32_t)timers.Remaining(swingCooldownTimer),
+      .waveIn = (uint32_t)timers.Remaining(waveTimer),
+      .meleeEnemies = (uint32_t)level->meleeEnemies.size(),
+      .rangedEnemies = (uint32_t)level->rangedEnemies.size(),
+      .bullets = (uint32_t)level->bullets.size(),
+      .items = (uint32_t)level->items.size(),
+      .obstacles = (uint32_t)CountMovingObstacles(),
+      .inAttackAnimation = inAttackAnimation,
+      .canSwing = canSwing,
+      .staggerPhase = simScheduler.staggerPhase,
+      .cameraTarget = camera.target,
+    });
+
+    into.Write(PlayerRecord{
+      .body = SaveCharacter(*player),
+      .jumpFrame = player->jumpFrame,
+      .framesAfterFallingOff = player->framesAfterFallingOff,
+      .kills = player->kills,
+      .killsThreshold = player->killsThreshold,
+      .weaponPosition = weapon->position,
+      .airControlFactor = player->airControlFactor,
+      .isGrounded = player->isGrounded,
+      .facingLeft = player->facingDirection == "left",
+    });
+
+    auto active = activeMeleeEnemies.begin();
+    for (MeleeEnemy* m : level->meleeEnemies) {
+      bool isActive = active != activeMeleeEnemies.end() && *active == m;
+      if (isActive) {
+        ++active;
+      }
+      into.Write(MeleeEnemyRecord{
+        .body = SaveCharacter(*m),
+        .jumpFrame = m->jumpFrame,
+        .speedModifier = m->speedModifier,
+        .untilTurn = m->untilTurn,
+        .wakeIn = WakeIn(m->wakeTick),
+        .active = isActive,
+        .isMovingLeft = m->isMovingLeft,
+        .isMovingRight = m->isMovingRight,
+        .isJumping = m->isJumping,
+        .isGrounded = m->isGrounded,
+        .isFollowingPlayer = m->isFollowingPlayer,
+      });
+    }
+    for (RangedEnemy* r : level->rangedEnemies) {
+      into.Write(
+        RangedEnemyRecord{SaveCharacter(*r), r->heading, WakeIn(r->wakeTick)}
+      );
+    }
+    for (Bullet* b : level->bullets) {
+      into.Write(BulletRecord{b->position, b->direction, b->speed});
+    }
+    for (Item* i : level->items) {
+      into.Write(ItemRecord{i->position});
+    }
+    for (Obstacle* o : level->obstacles) {
+      if (o->type == ObstacleType::MOVING) {
+        into.Write(ObstacleRecord{
+          .position = o->position,
+          .progress = o->progress,
+          .isMovingForward = o->isMovingForward,
+        });
+      }
+    }
+  }
+
+  // False, leaving the world as it is, for a snapshot of a different level
+  bool Restore(const WorldSnapshot& from) {
+    size_t at = 0;
+    if (from.bytes.size() < sizeof(WorldRecord)) {
+      std::cerr << "Snapshot is empty" << std::endl;
+      return false;
+    }
+    WorldRecord world = from.Read<WorldRecord>(at);
+    size_t size = sizeof(WorldRecord) + sizeof(PlayerRecord) +
+                  world.meleeEnemies * sizeof(MeleeEnemyRecord) +
+                  world.rangedEnemies * sizeof(RangedEnemyRecord) +
+                  world.bullets * sizeof(BulletRecord) +
+                  world.items * sizeof(ItemRecord) +
+                  world.obstacles * sizeof(ObstacleRecord);
+    if (from.bytes.size() != size ||
+        world.meleeEnemies != level->meleeEnemies.size() ||
+        world.obstacles != CountMovingObstacles()) {
+      std::cerr << "Snapshot doesn't match this level" << std::endl;
+      return false;
+    }
+
+    // Nothing may wait on the timers while what it refers to is replaced
+    for (MeleeEnemy* m : level->meleeEnemies) {
+      m->behavior.Stop();
+    }
+    for (RangedEnemy* r : level->rangedEnemies) {
+      r->behavior.Stop();
+    }
+    timers.Cancel(attackAnimationTimer);
+    timers.Cancel(swingCooldownTimer);
+    timers.Cancel(waveTimer);
+    crowd.Clear();
+
+    startTick = timers.now - world.elapsed;
+    random.state = world.random;
+    swingCooldownBuff = world.swingCooldownBuff;
+    inAttackAnimation = world.inAttackAnimation;
+    canSwing = world.canSwing;
+    simScheduler.staggerPhase = world.staggerPhase;
+    camera.target = world.cameraTarget;
+    if (world.attackAnimationIn > 0) {
+      ScheduleAttackAnimationEnd(world.attackAnimationIn);
+    }
+    if (world.swingCooldownIn > 0) {
+      ScheduleSwingCooldownEnd(world.swingCooldownIn);
+    }
+    if (world.waveIn > 0) {
+      ScheduleWave(world.waveIn);
+    }
+
+    PlayerRecord p = from.Read<PlayerRecord>(at);
+    LoadCharacter(*player, p.body);
+    player->airControlFactor = p.airControlFactor;
+    player->isGrounded = p.isGrounded;
+    player->facingDirection = p.facingLeft ? "left" : "right";
+    player->jumpFrame = p.jumpFrame;
+    player->framesAfterFallingOff = p.framesAfterFallingOff;
+    player->kills = p.kills;
+    player->killsThreshold = p.killsThreshold;
+    weapon->position = p.weaponPosition;
+
+    activeMeleeEnemies.clear();
+    inactiveMeleeEnemies.clear();
+    for (MeleeEnemy* m : level->meleeEnemies) {
+      MeleeEnemyRecord record = from.Read<MeleeEnemyRecord>(at);
+      LoadCharacter(*m, record.body);
+      m->isMovingLeft = record.isMovingLeft;
+      m->isMovingRight = record.isMovingRight;
+      m->isJumping = record.isJumping;
+      m->isGrounded = record.isGrounded;
+      m->isFollowingPlayer = record.isFollowingPlayer;
+      m->jumpFrame = record.jumpFrame;
+      m->speedModifier = record.speedModifier;
+      m->untilTurn = record.untilTurn;
+      m->wakeTick = WakeTick(record.wakeIn);
+      if (record.active) {
+        activeMeleeEnemies.push_back(m);
+      } else {
+        inactiveMeleeEnemies.push_back(m);
+      }
+    }
+
+    Resize(level->rangedEnemies, world.rangedEnemies, [] {
+      return new RangedEnemy({0, 0}, ENEMY_HALF_SIZES);
+    });
+    for (RangedEnemy* r : level->rangedEnemies) {
+      RangedEnemyRecord record = from.Read<RangedEnemyRecord>(at);
+      LoadCharacter(*r, record.body);
+      r->heading = record.heading;
+      r->wakeTick = WakeTick(record.wakeIn);
+    }
+
+    Resize(level->bullets, world.bullets, [] {
+      return new Bullet({0, 0}, {0, 0});
+    });
+    for (Bullet* b : level->bullets) {
+      BulletRecord record = from.Read<BulletRecord>(at);
+      b->position = record.position;
+      b->direction = record.direction;
+      b->speed = record.speed;
+    }
+
+    Resize(level->items, world.items, [] {
+      return new Item({0, 0}, ITEM_HALF_SIZES);
+    });
+    for (Item* i : level->items) {
+      i->position = from.Read<ItemRecord>(at).position;
+    }
+
+    for (Obstacle* o : level->obstacles) {
+      if (o->type == ObstacleType::MOVING) {
+        ObstacleRecord record = from.Read<ObstacleRecord>(at);
+        o->position = record.position;
+        o->progress = record.progress;
+        o->isMovingForward = record.isMovingForward;
+      }
+    }
+
+    // Last, behaviors look at the player and themselves as they start
+    for (MeleeEnemy* m : activeMeleeEnemies) {
+      crowd.Insert(m);
+      StartPatrol(m);
+    }
+    for (RangedEnemy* r : level->rangedEnemies) {
+      crowd.Insert(r);
+      StartShooter(r);
+    }
+    return true;
+  }
+
+ private:
+  void Swing() {
+    events.swung = true;
+    inAttackAnimation = true;
+    for (auto const& i : activeMeleeEnemies) {
+      if (weapon->IsIntersecting(i->GetCollider())) {
+        Kill(i);
+      }
+    }
+    for (auto const& i : level->rangedEnemies) {
+      if (weapon->IsIntersecting(i->GetCollider())) {
+        Kill(i);
+      }
+    }
+
+    ScheduleAttackAnimationEnd(SecondsToTicks(ATTACK_ANIMATION_LENGTH));
+    canSwing = false;
+    ScheduleSwingCooldownEnd(
+      SecondsToTicks(SWING_COOLDOWN - swingCooldownBuff)
+    );
+    if (player->killsThreshold >= pacing.killsPerWave) {
+      ScheduleWave(1);
+    }
+
+    for (Bullet* b : level->bullets) {
+      if (b->IsIntersecting(weapon->GetCollider())) {
+        b->direction = {-b->direction.x, -b->direction.y};
+      }
+    }
+  }
+
+  void Kill(Character* c) {
+    events.kills.push_back(c->position);
+    c->kill();
+    player->kills += 1;
+    player->killsThreshold += 1;
+    if (log != nullptr) {
+      *log << "KILLS: " << player->kills << std::endl;
+    }
+  }
+
+  // Pushed along when the player nears an edge of the view, otherwise
+  // drifts towards them, and never shows past the level
+  void FollowPlayer() {
+    float windowLeft = camera.target.x + properties->camUpperLeft.x;
+    float windowRight = camera.target.x + properties->camLowerRight.x;
+    float windowTop = camera.target.y + properties->camUpperLeft.y;
+    float windowBot = camera.target.y + properties->camLowerRight.y;
+
+    float driftX = Clamp(
+      player->position.x - (windowLeft + windowRight) / 2,
+      -properties->camDrift, properties->camDrift
+    );
+    float driftY = Clamp(
+      player->position.y - (windowTop + windowBot) / 2, -properties->camDrift,
+      properties->camDrift
+    );
+
+    float cameraPushX = 0.0f;
+    float cameraPushY = 0.0f;
+    if ((player->position.x + player->halfSizes.x) > windowRight) {
+      cameraPushX = (player->position.x + player->halfSizes.x) - windowRight;
+      camera.target.x += cameraPushX;
+    } else if ((player->position.x - player->halfSizes.x) < windowLeft) {
+      cameraPushX = (player->position.x - player->halfSizes.x) - windowLeft;
+      camera.target.x += cameraPushX;
+    } else {
+      camera.target.x += driftX;
+    }
+
+    if ((player->position.y + player->halfSizes.y) > windowBot) {
+      cameraPushY = (player->position.y + player->halfSizes.y) - windowBot;
+      camera.target.y += cameraPushY;
+    } else if ((player->position.y - player->halfSizes.y) < windowTop) {
+      cameraPushY = (player->position.y - player->halfSizes.y) - windowTop;
+      camera.target.y += cameraPushY;
+    } else {
+      camera.target.y += driftY;
+    }
+
+    // Clamp camera
+    camera.target.x = Clamp(camera.target.x, 450, 750);
+    camera.target.y = Clamp(camera.target.y, 300, 750);
+  }
+
+  void AddRangedEnemy(Vector2 position) {
+    RangedEnemy* r = new RangedEnemy(position, ENEMY_HALF_SIZES);
+    r->random.state = random.Next();
+    level->rangedEnemies.push_back(r);
+    crowd.Insert(r);
+    StartShooter(r);
+  }
+
+  size_t CountMovingObstacles() const {
+    size_t count = 0;
+    for (Obstacle* o : level->obstacles) {
+      count += o->type == ObstacleType::MOVING;
+    }
+    return count;
+  }
+
+  uint32_t WakeIn(uint64_t wakeTick) const {
+    return wakeTick > timers.now ? (uint32_t)(wakeTick - timers.now) : 0;
+  }
+
+  uint64_t WakeTick(uint32_t wakeIn) const {
+    return wakeIn > 0 ? timers.now + wakeIn : 0;
+  }
+
+  static CharacterRecord SaveCharacter(const Character& c) {
+    return {
+      c.position,         c.velocity,  c.health,       c.updateTier,
+      c.ticksSinceUpdate, c.timeScale, c.random.state,
+    };
+  }
+
+  static void LoadCharacter(Character& c, const CharacterRecord& record) {
+    c.position = record.position;
+    c.velocity = record.velocity;
+    c.health = record.health;
+    c.updateTier = record.updateTier;
+    c.ticksSinceUpdate = record.ticksSinceUpdate;
+    c.timeScale = record.timeScale;
+    c.random.state = record.random;
+  }
+
+  // Reuses what's there, only allocating or freeing the difference
+  template <typename T, typename Make>
+  static void Resize(std::vector<T*>& entities, size_t count, Make make) {
+    while (entities.size() > count) {
+      delete entities.back();
+      entities.pop_back();
+    }
+    while (entities.size() < count) {
+      entities.push_back(make());
+    }
+  }
+};
+
+#endif
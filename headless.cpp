@@ -0,0 +1,106 @@
+#include <raylib.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "headers/level.hpp"
+#include "headers/properties.hpp"
+#include "headers/replay.hpp"
+#include "headers/savegame.hpp"
+#include "headers/snapshot.hpp"
+#include "headers/statehash.hpp"
+#include "headers/world.hpp"
+
+// Runs the game's simulation without a window, sound or anyone playing,
+// and streams the state hash of every tick the way the game does. Either
+// plays back the replay the game recorded:
+//   headless replay.bin [hashes.bin]
+// or plays a seeded input script until the player dies or time runs out:
+//   headless --script 42 [ticks] [hashes.bin]
+// hashcompare then tells whether two runs went through the same states.
+
+const char* HEADLESS_HASH_FILENAME("statehash_headless.bin");
+const long SCRIPT_TICKS(60 * 60 * 10);  // ten minutes
+
+int main(int argc, char* argv[]) {
+  SetTraceLogLevel(LOG_WARNING);
+
+  bool scripted = argc >= 3 && strcmp(argv[1], "--script") == 0;
+  if (argc < 2 || (!scripted && argc > 3) || (scripted && argc > 5)) {
+    std::cerr << "Usage: headless replay.bin [hashes.bin]" << std::endl
+              << "       headless --script seed [ticks] [hashes.bin]"
+              << std::endl;
+    return 2;
+  }
+
+  Properties* properties =
+    LoadProperties(PROPERTIES_FILENAME, TICKS_PER_SECOND);
+  Level* level = Level::LoadLevel(LEVEL_FILENAME);
+  level->GeneratePaths();
+  uint64_t levelHash = HashLevelLayout(level);
+  World world(level, properties);
+  world.log = nullptr;
+
+  Replay replay;
+  InputScript script(scripted ? strtoul(argv[2], nullptr, 10) : 0);
+  long ticks = SCRIPT_TICKS;
+  const char* hashFilename = HEADLESS_HASH_FILENAME;
+  if (scripted) {
+    if (argc >= 4) {
+      ticks = strtol(argv[3], nullptr, 10);
+    }
+    if (argc >= 5) {
+      hashFilename = argv[4];
+    }
+  } else {
+    if (!replay.Load(argv[1], levelHash) || !replay.Begin(world)) {
+      return 1;
+    }
+    ticks = replay.Ticks();
+    if (argc >= 3) {
+      hashFilename = argv[2];
+    }
+  }
+
+  StateHashWriter stateHashes;
+  if (!stateHashes.Open(hashFilename)) {
+    return 1;
+  }
+  WorldSnapshot snapshot;
+  double simulated = 0;
+  long tick = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (; tick < ticks; ++tick) {
+    if (scripted) {
+      simulated += TIMESTEP;
+      script.BeginTick(world, simulated);
+    } else {
+      replay.BeginTick(tick, world.input);
+    }
+    world.Tick();
+    world.Snapshot(snapshot);
+    stateHashes.Write(HashState(snapshot));
+
+    // Where the game stops ticking too
+    if (scripted && world.player->health <= 0) {
+      ++tick;
+      break;
+    }
+  }
+  std::chrono::duration<double, std::micro> took =
+    std::chrono::steady_clock::now() - start;
+  stateHashes.Close();
+
+  std::cout << tick << " ticks (" << tick * TIMESTEP << " s of play) in "
+            << took.count() / 1000 << " ms, "
+            << (tick > 0 ? took.count() / tick : 0) << " us per tick"
+            << std::endl
+            << "Kills: " << world.player->kills
+            << ", health left: " << world.player->health << std::endl
+            << "State hashes written to " << hashFilename << std::endl;
+
+  delete properties;
+  return 0;
+}
@@ -6,25 +6,47 @@
 #include <list>
 #include <vector>
 
+#include "headers/allocations.hpp"
+#include "headers/assets.hpp"
+#include "headers/audio.hpp"
+#include "headers/atlas.hpp"
 #include "headers/bezier.hpp"
+#include "headers/broadphase.hpp"
+#include "headers/culling.hpp"
 #include "headers/enemies.hpp"
+#include "headers/framestats.hpp"
+#include "headers/input.hpp"
+#include "headers/latency.hpp"
 #include "headers/level.hpp"
+#include "headers/particles.hpp"
 #include "headers/properties.hpp"
+#include "headers/renderqueue.hpp"
+#include "headers/replay.hpp"
+#include "headers/savegame.hpp"
+#include "headers/statehash.hpp"
 #include "headers/uihandler.hpp"
+#include "headers/world.hpp"
 
-const char *LEVEL_FILENAME("level.cfg");
-const char *PROPERTIES_FILENAME("properties.cfg");
-
-const float WINDOW_WIDTH(1280);
-const float WINDOW_HEIGHT(720);
+const float WINDOW_WIDTH(VIEW_WIDTH);
+const float WINDOW_HEIGHT(VIEW_HEIGHT);
 const char *WINDOW_TITLE("⚔ HAKENSLASH THE PLATFORMER ⚔");
 
-const int TARGET_FPS(60);
-const float TIMESTEP(1.0f / (float)TARGET_FPS);
+const int TARGET_FPS(TICKS_PER_SECOND);
+
+const int REWIND_SECONDS(5);
+const int KILL_PARTICLES(60);
+const float KILL_PARTICLE_SPEED(350);
+const float KILL_PARTICLE_LIFETIME(1.2f);
 
-const float START_TIME(30.0f);  // in seconds
-const float ATTACK_ANIMATION_LENGTH(0.15f);
-const float SWING_COOLDOWN(.75f);
+// Where each sprite sits in its texture and how big it's drawn
+const Rectangle KNIGHT_SPRITE_SOURCE({0, 0, 24, 48});
+const Rectangle SWORD_SPRITE_SOURCE({0, 0, 125, 125});
+const Rectangle MELEE_ENEMY_SPRITE_SOURCE({56, 120, 430, 280});
+const Vector2 MELEE_ENEMY_SPRITE_SIZE({72.25, 47.25});
+const Vector2 MELEE_ENEMY_SPRITE_ORIGIN({30.375, 27.5});
+const Rectangle RANGED_ENEMY_SPRITE_SOURCE({108, 128, 280, 267});
+const Vector2 RANGED_ENEMY_SPRITE_SIZE({100.8 / 2, 96.48 / 2});
+const Vector2 RANGED_ENEMY_SPRITE_ORIGIN({50.4 - 25, 48.24 - 20});
 
 float findRotationAngle(Vector2 characterPos, Vector2 mousePos) {
   float resultAngle;
@@ -34,6 +56,24 @@ float findRotationAngle(Vector2 characterPos, Vector2 mousePos) {
 }
 
 int main() {
+  // Start decoding right away so it overlaps with level loading and window
+  // setup
+  AssetArchive archive;
+  AssetCache cache;
+  AssetManager assets;
+  if (archive.Open(ASSET_ARCHIVE_FILENAME)) {
+    assets.archive = &archive;
+  }
+  assets.cache = &cache;
+  assets.Start();
+  assets.StartWatching();
+  SpriteAtlas atlas;
+  atlas.Load(ATLAS_TABLE_FILENAME, &assets);
+  Asset *gameBgm = assets.Acquire("./assets/Spook3.mp3", MUSIC_ASSET);
+  Asset *swordSwing = assets.Acquire("./assets/swordSwing.wav", SOUND_ASSET);
+  Asset *bloodSplatter =
+    assets.Acquire("./assets/bloodSplatter.wav", SOUND_ASSET);
+
   UIState state;
   MenuHandler menuHandler;
   menuHandler.initialize(WINDOW_WIDTH, WINDOW_HEIGHT);
@@ -42,77 +82,73 @@ int main() {
   Level *level = Level::LoadLevel(LEVEL_FILENAME);
   level->GeneratePaths();
 
-  float attackAnimTimeLeft = ATTACK_ANIMATION_LENGTH;
-  float swingCooldownTimeLeft = 0.0f;
-  float swingCooldownBuff = 0.0f;
-  Player *player = level->player;
-  PlayerWeapon *weapon = new PlayerWeapon(player->position, {40, 60});
-  bool inAttackAnimation = false;
-  bool canSwing = false;
+  // Only what's inside the camera view gets drawn
+  Culler culler;
+  culler.Build(level->obstacles);
+  VisibleSet visible;
+  RenderQueue worldQueue;
+  ParticleSystem particles;
+
+  // Everything the game changes while playing, with the enemies out and
+  // their behaviors started. It only moves on by fixed ticks while in game.
+  World world(level, properties);
+  SweepAndPrune &crowd = world.crowd;
+  std::list<MeleeEnemy *> &activeMeleeEnemies = world.activeMeleeEnemies;
+  Player *player = world.player;
+  PlayerWeapon *weapon = world.weapon;
+  InputBuffer &input = world.input;
+  Camera2D &cameraView = world.camera;
+  LatencyTracker latency;
+  FrameStats frameStats;
   bool showWeaponHitbox = false;
 
+  // Going back to the main menu puts the world back to this
+  WorldSnapshot startSnapshot;
+  world.Snapshot(startSnapshot);
+  // The last few seconds of ticks, for rewinding
+  RewindBuffer rewind(REWIND_SECONDS * TARGET_FPS);
+  // Quick saves, written in the background
+  SaveWriter saves;
+  uint64_t levelHash = HashLevelLayout(level);
+  WorldSnapshot saveSnapshot;
+  std::vector<unsigned char> saveBytes;
+  // Every tick's input and state hash since the world was last put back,
+  // by a new game, a rewind or a load
+  ReplayWriter replayWriter;
+  StateHashWriter stateHashes;
+  bool recording = false;
+  WorldSnapshot recordingStart;
+  // The HUD follows the ticks, after a restore it has to catch up
+  auto showRestoredWorld = [&] {
+    menuHandler.inGameGUI.hpBar.UpdateHealth(player->health);
+    menuHandler.inGameGUI.score = world.Score();
+  };
 
   menuHandler.inGameGUI.hpBar.InitBar(player->health);
 
-  RangedEnemy *enemy = new RangedEnemy({300, 400}, {20, 20});
-  MeleeEnemy *menemy = new MeleeEnemy({500, 200}, {20, 20});
-  MeleeEnemy *menemy2 = new MeleeEnemy({500, 400}, {20, 20});
-  MeleeEnemy *menemy3 = new MeleeEnemy({200, 500}, {20, 20});
-  MeleeEnemy *menemy4 = new MeleeEnemy({600, 420}, {20, 20});
-  MeleeEnemy *menemy5 = new MeleeEnemy({400, 120}, {20, 20});
-  MeleeEnemy *menemy6 = new MeleeEnemy({300, 120}, {20, 20});
-  MeleeEnemy *menemy7 = new MeleeEnemy({800, 280}, {20, 20});
-  MeleeEnemy *menemy8 = new MeleeEnemy({200, 1000}, {20, 20});
-  MeleeEnemy *menemy9 = new MeleeEnemy({800, 120}, {20, 20});
-
-  level->rangedEnemies.push_back(new RangedEnemy({300, 400}, {20, 20}));
-  level->rangedEnemies.push_back(new RangedEnemy({900, 400}, {20, 20}));
-
-  Camera2D cameraView = {0};
-  cameraView.target = {player->position.x, player->position.y};
-  cameraView.offset = {WINDOW_WIDTH / 2, WINDOW_HEIGHT / 2};
-  cameraView.zoom = 1.3f;
-
-  Vector2 cameraPos = {player->position.x, player->position.y};
-
-  std::list<MeleeEnemy *> activeMeleeEnemies{menemy, menemy2, menemy3};
-  std::list<MeleeEnemy *> inactiveMeleeEnemies{menemy4, menemy5, menemy6,
-                                               menemy7, menemy8, menemy9};
-
-  float timeLeft = START_TIME;
-  float timeElapsed = 0.0f;
-
   float accumulator = 0.0f;
+  bool worldChanged = false;  // since startSnapshot was restored
   float delta = 0.0f;
   InitAudioDevice();
+  AudioThread::ConfigureStreams();
   InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE);
   SetTargetFPS(TARGET_FPS);
 
-  Texture heartFull = LoadTexture("./assets/Heart_Full.png");
-  Texture heartHalf = LoadTexture("./assets/Heart_Half.png");
-  Texture heartEmpty = LoadTexture("./assets/Heart_Empty.png");
-  Texture gameOverBackground = LoadTexture("./assets/GameOver.png");
-
-  menuHandler.inGameGUI.hpBar.heart_full = heartFull;
-  menuHandler.inGameGUI.hpBar.heart_half = heartHalf;
-  menuHandler.inGameGUI.hpBar.heart_empty = heartEmpty;
+  assets.WaitAll();
 
-  Texture swordIdleTexture = LoadTexture("./assets/swordIdle.png");
-  Texture swordAttackTexture = LoadTexture("./assets/swordAttack.png");
-  Texture enemyMeleeTexture = LoadTexture("./assets/enemyMelee.png");
-  Texture enemyRangedTexture = LoadTexture("./assets/enemyRanged.png");
-  Texture knightTexture = LoadTexture("./assets/knight.png");
-  Texture floor = LoadTexture("./assets/Floor.png");
-  Texture mainMenuBackground = LoadTexture("./assets/Hakenslash.png");
+  AudioThread audio;
+  audio.AddVoices(swordSwing, 2);
+  audio.AddVoices(bloodSplatter, 4);
+  assets.beforeReload = [&audio](Asset *asset) { audio.DropVoices(asset); };
+  audio.Start();
+  audio.PlayMusic(gameBgm, 0.15);
 
-  Texture itemHealthTexture = LoadTexture("./assets/Heart_Full.png");
-
-  Music gameBgm = LoadMusicStream("./assets/Spook3.mp3");
-  Sound swordSwing = LoadSound("./assets/swordSwing.wav");
-  Sound bloodSplatter = LoadSound("./assets/bloodSplatter.wav");
-
-  PlayMusicStream(gameBgm);
-  SetMusicVolume(gameBgm, 0.15);
+  // Per frame budgets, only checked when built with -DTRACK_ALLOCATIONS.
+  // Bullets, waves and the HUD text allocate a little, the enemies only
+  // when their brains start watching a new row.
+  const int tickAllocations = allocationTracker.AddScope("ticks", 48, 20480);
+  const int renderAllocations = allocationTracker.AddScope("render", 16, 16384);
+  const int uiAllocations = allocationTracker.AddScope("ui", 32, 8192);
 
   while (!WindowShouldClose()) {
     delta = GetFrameTime();
@@ -120,208 +156,99 @@ int main() {
     state = menuHandler.getState();
 
     if (state == InGame) {
-      float windowLeft = cameraView.target.x + properties->camUpperLeft.x;
-      float windowRight = cameraView.target.x + properties->camLowerRight.x;
-      float windowTop = cameraView.target.y + properties->camUpperLeft.y;
-      float windowBot = cameraView.target.y + properties->camLowerRight.y;
-
-      // Player Movement
-      player->MoveHorizontal(properties);
-      player->CollideHorizontal(level->obstacles, properties->gap);
-      player->MoveVertical(properties);
-      player->CollideVertical(level->obstacles, properties->gap);
-
-      weapon->Update(player, level->bullets);
-
       if (IsKeyPressed(KEY_TAB)) {
         menuHandler.setState(InPauseScreen);
       }
 
-      // Attacking
-      if (IsKeyPressed(KEY_J) && canSwing) {
-        PlaySound(swordSwing);
-        inAttackAnimation = true;
-        for (auto const &i : activeMeleeEnemies) {
-          if (weapon->IsIntersecting(i->GetCollider())) {
-            i->kill();
-            PlaySound(bloodSplatter);
-            player->kills += 1;
-            player->killsThreshold += 1;
-            std::cout << "KILLS: " << player->kills << std::endl;
-          }
-        }
-
-        for (auto const &i : level->rangedEnemies) {
-          if (weapon->IsIntersecting(i->GetCollider())) {
-            i->kill();
-            PlaySound(bloodSplatter);
-            player->kills += 1;
-            player->killsThreshold += 1;
-            std::cout << "KILLS: " << player->kills << std::endl;
-          }
-        }
-
-        canSwing = false;
-        swingCooldownTimeLeft = SWING_COOLDOWN - swingCooldownBuff;
-
-        for (Bullet *b : level->bullets) {
-          if (b->IsIntersecting(weapon->GetCollider())) {
-            b->direction = {-b->direction.x, -b->direction.y};
-          }
+      input.Poll();
+      worldChanged = true;
+      if (IsKeyDown(KEY_R)) {
+        // One tick back per frame for as long as R is held
+        const WorldSnapshot *previous = rewind.Newest();
+        if (previous != nullptr) {
+          world.Restore(*previous);
+          rewind.Pop();
+          showRestoredWorld();
+          recording = false;
         }
-      }
-      // Enemy Movement
-      for (auto const &i : activeMeleeEnemies) {
-        i->Update(properties, level->obstacles, player);
-      }
-
-      if (player->killsThreshold == 10) {
-        // Add an item
-        if (level->items.empty()) {
-          int itemSpawnIndex = rand() % level->itemSpawns.size();
-          Item *newItem = new Item(level->itemSpawns[itemSpawnIndex], {20, 20});
-          level->items.push_back(newItem);
-        }
-        // Add 2 ranged enemies
-        level->rangedEnemies.push_back(new RangedEnemy({300, 400}, {20, 20}));
-        level->rangedEnemies.push_back(new RangedEnemy({900, 400}, {20, 20}));
-
-        if (inactiveMeleeEnemies.size() > 0) {
-          activeMeleeEnemies.push_back(inactiveMeleeEnemies.front());
-          inactiveMeleeEnemies.pop_front();
-          std::cout << "ADDED 1 ENEMY" << std::endl;
-        }
-        for (auto const &i : activeMeleeEnemies) {
-          i->speedModifier += 0.025;
-        }
-
-        swingCooldownBuff += 0.05f;
-        std::cout << "Added 0.025 speed" << std::endl;
-        player->killsThreshold = 0;
-      }
-
-      float cameraPushX = 0.0f;
-      float cameraPushY = 0.0f;
-      float driftX = Clamp(
-        player->position.x - (windowLeft + windowRight) / 2,
-        -properties->camDrift, properties->camDrift
-      );
-      float driftY = Clamp(
-        player->position.y - (windowTop + windowBot) / 2, -properties->camDrift,
-        properties->camDrift
-      );
-
-      if ((player->position.x + player->halfSizes.x) > windowRight) {
-        cameraPushX = (player->position.x + player->halfSizes.x) - windowRight;
-        // std::cout << "CAM PUSHING RIGHT" << std::endl;
-        cameraView.target.x += cameraPushX;
-      } else if ((player->position.x - player->halfSizes.x) < windowLeft) {
-        cameraPushX = (player->position.x - player->halfSizes.x) - windowLeft;
-        // std::cout << "CAM PUSHING LEFT" << std::endl;
-        cameraView.target.x += cameraPushX;
-      } else {
-        cameraView.target.x += driftX;
-        // std::cout << "DRIFTING HORIZONTALLY" << std::endl;
-      }
-
-      if ((player->position.y + player->halfSizes.y) > windowBot) {
-        cameraPushY = (player->position.y + player->halfSizes.y) - windowBot;
-        // std::cout << "CAM PUSHING BOT" << std::endl;
-        cameraView.target.y += cameraPushY;
-      } else if ((player->position.y - player->halfSizes.y) < windowTop) {
-        cameraPushY = (player->position.y - player->halfSizes.y) - windowTop;
-        // std::cout << "CAM PUSHING TOP" << std::endl;
-        cameraView.target.y += cameraPushY;
+        input.Reset();
+        accumulator = 0;
       } else {
-        cameraView.target.y += driftY;
-        // std::cout << "DRIFTING VERTICALLY" << std::endl;
+        accumulator += delta;
       }
+      while (accumulator >= TIMESTEP) {
+        AllocationScope allocationScope(tickAllocations);
+        frameStats.BeginTick();
 
-      // Clamp camera
-      cameraView.target.x = Clamp(cameraView.target.x, 450, 750);
-      cameraView.target.y = Clamp(cameraView.target.y, 300, 750);
-
-      if (IsKeyPressed(KEY_Q)) {
-        showWeaponHitbox = !showWeaponHitbox;
-      }
+        particles.Update(TIMESTEP);
 
-      accumulator += delta;
-      while (accumulator >= TIMESTEP) {
-        // TIMER
-        timeLeft -= accumulator;
-        timeElapsed += accumulator;
-
-        level->Update({0, 0, 1200, 1200}, TIMESTEP);
-        for (size_t i = 0; i < level->bullets.size(); ++i) {
-          Bullet *b = level->bullets[i];
-          if (b->CollidePlayer(player)) {
-            player->health -= 1;
-            level->bullets.erase(level->bullets.begin() + i);
-            delete b;
-          }
-          if (b->IsOutsideLimits({0, 0, 1200, 1200})) {
-            level->bullets.erase(level->bullets.begin() + i);
-            delete b;
-          }
+        if (!recording) {
+          world.Snapshot(recordingStart);
+          replayWriter.Open(REPLAY_FILENAME, recordingStart, levelHash, input);
+          stateHashes.Open(STATE_HASH_FILENAME);
+          recording = true;
         }
 
-        for (size_t i = 0; i < level->rangedEnemies.size(); ++i) {
-          RangedEnemy *r = level->rangedEnemies[i];
-          if (rand() % 100 > 98) {
-            level->bullets.push_back(r->Shoot(player));
-          }
-          r->Update(properties, level->obstacles);
-          if (r->CollidePlayer(player)) {
-            player->health -= 1;
-            level->rangedEnemies.erase(level->rangedEnemies.begin() + i);
-            delete r;
-          }
-        }
+        // Input polled this frame, up to the end of this tick
+        float behind = accumulator - TIMESTEP;
+        input.BeginTick(behind < TIMESTEP ? 0 : behind);
+        replayWriter.Tick(input);
 
-        if (swingCooldownTimeLeft <= 0.0f && !canSwing) {
-          canSwing = true;
-        } else {
-          swingCooldownTimeLeft -= TIMESTEP;
-        }
+        world.Tick();
 
-        if (inAttackAnimation) {
-          attackAnimTimeLeft -= TIMESTEP;
-          if (attackAnimTimeLeft <= 0) {
-            inAttackAnimation = false;
-            attackAnimTimeLeft = ATTACK_ANIMATION_LENGTH;
-          }
+        if (world.events.swung) {
+          audio.PlaySound(swordSwing);
         }
-
-        if (!level->items.empty() && level->items[0]->Update(player, timeLeft)) {
-          delete level->items[0];
-          level->items.clear();
+        for (Vector2 at : world.events.kills) {
+          audio.PlaySoundAt(bloodSplatter, at, player->position);
+          particles.Burst(
+            at, KILL_PARTICLES, KILL_PARTICLE_SPEED, KILL_PARTICLE_LIFETIME
+          );
         }
 
         menuHandler.inGameGUI.hpBar.UpdateHealth(player->health);
-        newScore = player->kills * 10;
+        menuHandler.inGameGUI.score = world.Score();
 
         if (player->health <= 0) {
-          menuHandler.gameOverScreen.scoreLabel.text =
-            "SCORE: " + std::to_string(newScore);
-          menuHandler.gameOverScreen.playerName.letterCount = 0;
+          menuHandler.gameOverScreen.ShowScore(world.Score());
           menuHandler.setState(InGameOverScreen);
         }
+        world.Snapshot(rewind.Push());
+        stateHashes.Write(HashState(*rewind.Newest()));
+        frameStats.EndTick();
         accumulator -= TIMESTEP;
       }
+
+      if (IsKeyPressed(KEY_Q)) {
+        showWeaponHitbox = !showWeaponHitbox;
+      }
+      if (IsKeyPressed(KEY_L)) {
+        latency.showOverlay = !latency.showOverlay;
+      }
+      if (IsKeyPressed(KEY_F)) {
+        frameStats.showOverlay = !frameStats.showOverlay;
+      }
+      if (IsKeyPressed(KEY_F5)) {
+        world.Snapshot(saveSnapshot);
+        saves.Queue(saveSnapshot, levelHash, SAVE_FILENAME);
+      }
+      if (IsKeyPressed(KEY_F9) && ReadSaveFile(SAVE_FILENAME, saveBytes) &&
+          DecodeSave(saveBytes, levelHash, saveSnapshot) &&
+          world.Restore(saveSnapshot)) {
+        rewind.Clear();
+        particles.Clear();
+        showRestoredWorld();
+        recording = false;
+      }
     } else {
-      if (state == InMainMenu) {
-        //----------------------------------
-        // TODO: Write Code that resets the game
-        //----------------------------------
-        level->player->health = 10;
-        level->player->kills = 0;
-        level->player->killsThreshold = 0;
-        activeMeleeEnemies = {menemy, menemy2, menemy3};
-        inactiveMeleeEnemies = {menemy4, menemy5, menemy6, menemy7, menemy8, menemy9};
-        level->rangedEnemies = {new RangedEnemy({900, 400}, {20, 20}), new RangedEnemy({300, 400}, {20, 20})};
-        level->bullets = {};
-        swingCooldownBuff = 0.0f;
-        level->player->position = {100,500};
+      input.Reset();
+      if (state == InMainMenu && worldChanged) {
+        world.Restore(startSnapshot);
+        rewind.Clear();
+        particles.Clear();
+        showRestoredWorld();
+        recording = false;
+        worldChanged = false;
       } else if (state == InPauseScreen) {
         if (IsKeyPressed(KEY_TAB)) {
           menuHandler.setState(InGame);
@@ -329,115 +256,92 @@ int main() {
       }
     }
 
+    SwitchAllocationScope(uiAllocations);
     menuHandler.Update();
+    SwitchAllocationScope(0);
 
-    UpdateMusicStream(gameBgm);
+    {
+      std::lock_guard<std::mutex> lock(audio.assetMutex);
+      assets.Update();
+    }
 
+    SwitchAllocationScope(renderAllocations);
     BeginDrawing();
     BeginMode2D(cameraView);
     ClearBackground(WHITE);
 
-    DrawTexture(floor, 0, 0, WHITE);
+    SpriteRegion floor = atlas.Get(SPRITE_FLOOR);
+    worldQueue.SpriteAt(LAYER_FLOOR, floor.texture, floor.source, {0, 0});
 
     if (state == InGame) {
-      level->Draw();
-
-      for (RangedEnemy *r : level->rangedEnemies) {
-        Rectangle enemyRec;
-        Rectangle enemyWindowRec;
-        enemyRec.x = 108;
-        enemyRec.y = 128;
-        enemyRec.width = 280;
-        enemyRec.height = 267;
-        enemyWindowRec.x = r->position.x;
-        enemyWindowRec.y = r->position.y;
-        enemyWindowRec.width = 100.8 / 2;
-        enemyWindowRec.height = 96.48 / 2;
-        DrawTexturePro(
-          enemyRangedTexture, enemyRec, enemyWindowRec, {50.4 - 25, 48.24 - 20},
-          findRotationAngle(level->player->position, r->position) * RAD2DEG,
-          WHITE
-        );
+      culler.Gather(
+        cameraView, WINDOW_WIDTH, WINDOW_HEIGHT, level, activeMeleeEnemies,
+        visible
+      );
+
+      for (Obstacle *o : visible.obstacles) {
+        o->Submit(worldQueue, LAYER_LEVEL);
       }
-      Rectangle knightRec;
-      knightRec.x = 0;
-      knightRec.y = 0;
-      knightRec.height = 48;
-      if (level->player->facingDirection == "left") {
-        knightRec.width = -24;
-      } else {
-        knightRec.width = 24;
+      for (Bullet *b : visible.bullets) {
+        b->Submit(worldQueue, LAYER_PROJECTILES);
       }
-      DrawTextureRec(
-        knightTexture, knightRec,
-        {level->player->position.x - 12, level->player->position.y - 25}, WHITE
-      );
-      if (inAttackAnimation) {
-        Rectangle swordRec;
-        float turnDirectionModifier = 0;
-        swordRec.x = 0;
-        swordRec.y = 0;
-        swordRec.height = 125;
-        if (player->facingDirection == "left") {
-          swordRec.width = 125;
-        } else {
-          swordRec.width = -125;
-          turnDirectionModifier = 10;
-        }
 
-        DrawTextureRec(
-          swordAttackTexture, swordRec,
-          {weapon->position.x - 70 + turnDirectionModifier,
-           weapon->position.y - 70},
-          WHITE
+      SpriteRegion enemyRanged = atlas.Get(SPRITE_ENEMY_RANGED);
+      for (RangedEnemy *r : visible.rangedEnemies) {
+        worldQueue.Sprite(
+          LAYER_RANGED_ENEMIES, enemyRanged.texture,
+          enemyRanged.Crop(RANGED_ENEMY_SPRITE_SOURCE),
+          {r->position.x, r->position.y, RANGED_ENEMY_SPRITE_SIZE.x,
+           RANGED_ENEMY_SPRITE_SIZE.y},
+          RANGED_ENEMY_SPRITE_ORIGIN,
+          findRotationAngle(level->player->position, r->position) * RAD2DEG
         );
-      } else {
-        Rectangle swordRec;
-        float turnDirectionModifier = 0;
-        swordRec.x = 0;
-        swordRec.y = 0;
-        swordRec.height = 125;
-        if (player->facingDirection == "left") {
-          swordRec.width = 125;
-        } else {
-          swordRec.width = -125;
-          turnDirectionModifier = 10;
-        }
-
-        DrawTextureRec(
-          swordIdleTexture, swordRec,
-          {weapon->position.x - 70 + turnDirectionModifier,
-           weapon->position.y - 70},
-          WHITE
+      }
+      SpriteRegion enemyMelee = atlas.Get(SPRITE_ENEMY_MELEE);
+      for (MeleeEnemy *i : visible.meleeEnemies) {
+        worldQueue.Sprite(
+          LAYER_MELEE_ENEMIES, enemyMelee.texture,
+          enemyMelee.Crop(MELEE_ENEMY_SPRITE_SOURCE),
+          {i->position.x, i->position.y, MELEE_ENEMY_SPRITE_SIZE.x,
+           MELEE_ENEMY_SPRITE_SIZE.y},
+          MELEE_ENEMY_SPRITE_ORIGIN,
+          findRotationAngle(level->player->position, i->position) * RAD2DEG
         );
       }
 
-      if (showWeaponHitbox) {
-        weapon->Draw();
+      Rectangle knightRec = KNIGHT_SPRITE_SOURCE;
+      Rectangle swordRec = SWORD_SPRITE_SOURCE;
+      float turnDirectionModifier = 0;
+      if (player->facingDirection == "left") {
+        knightRec.width = -knightRec.width;
+      } else {
+        swordRec.width = -swordRec.width;
+        turnDirectionModifier = 10;
       }
 
-      for (auto const &i : activeMeleeEnemies) {
-        Rectangle enemyRec;
-        Rectangle enemyWindowRec;
-
-        enemyRec.x = 56;
-        enemyRec.y = 120;
-        enemyRec.width = 430;
-        enemyRec.height = 280;
-        enemyWindowRec.x = i->position.x;
-        enemyWindowRec.y = i->position.y;
-        enemyWindowRec.width = 72.25;
-        enemyWindowRec.height = 47.25;
-        DrawTexturePro(
-          enemyMeleeTexture, enemyRec, enemyWindowRec, {30.375, 27.5},
-          findRotationAngle(level->player->position, i->position) * RAD2DEG,
-          WHITE
+      SpriteRegion knight = atlas.Get(SPRITE_KNIGHT);
+      SpriteRegion sword =
+        atlas.Get(
+          world.inAttackAnimation ? SPRITE_SWORD_ATTACK : SPRITE_SWORD_IDLE
         );
+      worldQueue.SpriteAt(
+        LAYER_PLAYER, knight.texture, knight.Crop(knightRec),
+        {level->player->position.x - 12, level->player->position.y - 25}
+      );
+      worldQueue.SpriteAt(
+        LAYER_WEAPON, sword.texture, sword.Crop(swordRec),
+        {weapon->position.x - 70 + turnDirectionModifier,
+         weapon->position.y - 70}
+      );
+
+      if (showWeaponHitbox) {
+        weapon->Submit(worldQueue, LAYER_DEBUG);
       }
 
-      if (!level->items.empty()) {
-        level->items[0]->Draw(
-          itemHealthTexture
+      for (Item *i : visible.items) {
+        i->Submit(
+          worldQueue, LAYER_ITEMS, LAYER_ITEM_ICONS,
+          atlas.Get(SPRITE_HEART_FULL)
         );
       }
 
@@ -446,43 +350,61 @@ int main() {
       //     windowTop, RED);
     }
 
+    worldQueue.Flush();
+    if (state == InGame) {
+      particles.Draw(
+        GetCameraBounds(cameraView, WINDOW_WIDTH, WINDOW_HEIGHT)
+      );
+    }
     EndMode2D();
-    menuHandler.menuList[InMainMenu]->loadBackgroundTexture(
-      mainMenuBackground
+
+    SwitchAllocationScope(uiAllocations);
+    menuHandler.menuList[InMainMenu]->loadBackgroundSprite(
+      atlas.Get(SPRITE_MAIN_MENU_BACKGROUND)
     );
-    menuHandler.menuList[InGameOverScreen]->loadBackgroundTexture(
-      gameOverBackground
+    menuHandler.menuList[InGameOverScreen]->loadBackgroundSprite(
+      atlas.Get(SPRITE_GAME_OVER_BACKGROUND)
+    );
+    menuHandler.inGameGUI.hpBar.SetHearts(
+      atlas.Get(SPRITE_HEART_FULL), atlas.Get(SPRITE_HEART_HALF),
+      atlas.Get(SPRITE_HEART_EMPTY)
     );
     menuHandler.Draw();
+    if (latency.showOverlay) {
+      latency.Draw(10, 10);
+    }
+    if (frameStats.showOverlay) {
+      frameStats.counts = {
+        (int)activeMeleeEnemies.size(), (int)level->rangedEnemies.size(),
+        (int)level->bullets.size(), particles.count, crowd.pairTests
+      };
+      frameStats.Draw(WINDOW_WIDTH - 345, 10);
+      if (ALLOCATION_TRACKING) {
+        allocationTracker.Draw(WINDOW_WIDTH - 345, 200);
+      }
+    }
+    SwitchAllocationScope(0);
 
+    latency.FrameDrawn(input);
+    frameStats.EndFrame(delta, allocationCount, allocationBytes);
+    allocationTracker.EndFrame();
     EndDrawing();
   }
 
-  UnloadTexture(heartFull);
-  UnloadTexture(heartHalf);
-  UnloadTexture(heartEmpty);
-  menuHandler.menuList[InGameOverScreen]->unloadBackgroundTexture();
-  menuHandler.menuList[InMainMenu]->unloadBackgroundTexture();
-  UnloadTexture(swordIdleTexture);
-  UnloadTexture(floor);
-  UnloadTexture(swordAttackTexture);
-  UnloadTexture(itemHealthTexture);
-  UnloadTexture(enemyMeleeTexture);
-  UnloadTexture(enemyRangedTexture);
-  UnloadTexture(knightTexture);
-  UnloadSound(swordSwing);
-  UnloadSound(bloodSplatter);
-  UnloadMusicStream(gameBgm);
+  latency.Export(LATENCY_FILENAME);
+  saves.Stop();
+  replayWriter.Close();
+  stateHashes.Close();
+  allocationTracker.Report();
+
+  audio.Stop();
+  menuHandler.Unload();
+  atlas.Unload();
+  assets.Shutdown();
+  archive.Close();
 
   CloseAudioDevice();
   CloseWindow();
 
-  // Delete pointers
-  delete player;
-  for (Obstacle *o : level->obstacles) {
-    delete o;
-  }
-  delete level;
-
   return 0;
 }
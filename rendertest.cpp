@@ -0,0 +1,82 @@
+#include <raylib.h>
+
+#include <cstring>
+#include <iostream>
+
+#include "headers/renderqueue.hpp"
+
+// Fills a render queue with sprites, shapes and text the way a frame does,
+// without a window, and checks how many batches it sorts into. Exits with
+// 1 when a check fails.
+
+int failures = 0;
+
+void Check(bool passed, const char* what) {
+  if (!passed) {
+    std::cerr << "FAILED: " << what << std::endl;
+    ++failures;
+  }
+}
+
+int main() {
+  SetTraceLogLevel(LOG_WARNING);
+
+  // Textures are only told apart by id, nothing is loaded
+  Texture first = {10, 64, 64, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+  Texture second = {11, 64, 64, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+  Rectangle source = {0, 0, 16, 16};
+
+  RenderQueue queue;
+  queue.SpriteAt(LAYER_LEVEL, first, source, {0, 0});
+  queue.Rect(LAYER_LEVEL, {0, 0, 10, 10}, RED);
+  queue.SpriteAt(LAYER_LEVEL, second, source, {20, 0});
+  queue.Text(LAYER_LEVEL, "level", 0, 0, 10, WHITE);
+  queue.SpriteAt(LAYER_LEVEL, first, source, {40, 0});
+  queue.Rect(LAYER_LEVEL, {20, 0, 10, 10}, BLUE);
+  queue.Circle(LAYER_LEVEL, {5, 5}, 5, GREEN);
+  queue.Text(LAYER_UI_TEXT, "score", 0, 0, 20, WHITE);
+  queue.Text(LAYER_UI_TEXT, "health", 0, 20, 20, WHITE);
+
+  // Shapes and default-font text are one batch when raylib gives them the
+  // same texture, as it does once a window is open
+  bool shapesShareFont =
+    GetShapesTexture().id == GetFontDefault().texture.id;
+
+  RenderStats unsorted = queue.GetStats();
+  Check(unsorted.commands == 9, "every command is counted");
+  Check(
+    unsorted.batches == (shapesShareFont ? 6 : 7),
+    "submission order breaks batches up"
+  );
+
+  queue.Sort();
+  RenderStats sorted = queue.GetStats();
+  Check(sorted.commands == 9, "sorting keeps every command");
+  Check(
+    sorted.batches == (shapesShareFont ? 4 : 5),
+    "each layer is one batch per texture"
+  );
+
+  bool ordered = true;
+  for (size_t i = 1; i < queue.commands.size(); ++i) {
+    const RenderCommand& a = queue.commands[i - 1];
+    const RenderCommand& b = queue.commands[i];
+    if (a.layer > b.layer ||
+        (a.layer == b.layer && a.textureKey == b.textureKey &&
+         a.sequence > b.sequence)) {
+      ordered = false;
+    }
+  }
+  Check(ordered, "layers go back to front, a texture keeps its order");
+  Check(
+    strcmp(queue.GetText(queue.commands.back()), "health") == 0,
+    "text is kept with its command"
+  );
+
+  queue.Clear();
+  Check(queue.GetStats().batches == 0, "an empty queue has no batches");
+
+  std::cout << (failures == 0 ? "All render queue checks passed" : "Failed")
+            << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,345 @@
+#include <raylib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "headers/hash.hpp"
+#include "headers/level.hpp"
+#include "headers/properties.hpp"
+#include "headers/replay.hpp"
+#include "headers/savegame.hpp"
+#include "headers/world.hpp"
+
+// Plays thousands of games without a window, spread over every core, to
+// see what tuning does to them. Every combination of the values in a grid
+// file is played once per seed, and the runs are summed up per
+// combination: how long the player survives, how many kills they get and
+// what a tick costs.
+//   simrunner [simgrid.cfg]
+// See simgrid.cfg for the format. The summary is also written to
+// simresults.csv.
+
+const char* GRID_FILENAME("simgrid.cfg");
+const char* RESULTS_FILENAME("simresults.csv");
+const long DEFAULT_SEEDS(100);
+const long DEFAULT_TICKS(60 * 60 * 10);  // ten minutes
+const int PROGRESS_INTERVAL_MS(10);
+
+// A setting the grid varies. Every value is tried with every value of the
+// others.
+struct GridAxis {
+  std::string name;
+  std::vector<float> values;
+};
+
+struct GridSettings {
+  long seeds = DEFAULT_SEEDS;  // worlds per combination, seeded 1, 2, ...
+  long ticks = DEFAULT_TICKS;  // longest a world is played
+  int threads = 0;             // 0 for one per core
+  std::string replayFilename;  // the input script is played when empty
+  std::vector<GridAxis> axes;
+};
+
+// One combination of values
+struct GridPoint {
+  Properties properties;
+  WavePacing pacing;
+  std::vector<float> values;  // one per axis
+};
+
+struct RunResult {
+  long ticks;
+  int kills;
+  bool survived;      // still alive when the tick limit came
+  double seconds;     // spent in World::Tick
+  double worstTick;  // seconds
+};
+
+bool IsPacingSetting(const std::string& name) {
+  return name == "KILLS_PER_WAVE" || name == "WAVE_SPEED_UP" ||
+         name == "WAVE_SWING_BUFF";
+}
+
+void SetPacing(WavePacing& pacing, const std::string& name, float value) {
+  if (name == "KILLS_PER_WAVE") {
+    pacing.killsPerWave = (int)value;
+  } else if (name == "WAVE_SPEED_UP") {
+    pacing.speedUp = value;
+  } else if (name == "WAVE_SWING_BUFF") {
+    pacing.swingBuff = value;
+  }
+}
+
+bool LoadGrid(const char filename[], GridSettings& settings) {
+  std::ifstream gridFile(filename);
+  if (!gridFile) {
+    std::cerr << "Unable to open " << filename << std::endl;
+    return false;
+  }
+
+  Properties scratch;
+  std::string line;
+  while (std::getline(gridFile, line)) {
+    std::istringstream words(line.substr(0, line.find('#')));
+    std::string name;
+    if (!(words >> name)) {
+      continue;
+    }
+    if (name == "SEEDS") {
+      words >> settings.seeds;
+    } else if (name == "TICKS") {
+      words >> settings.ticks;
+    } else if (name == "THREADS") {
+      words >> settings.threads;
+    } else if (name == "REPLAY") {
+      words >> settings.replayFilename;
+    } else {
+      if (!IsPacingSetting(name) &&
+          !SetProperty(&scratch, name, 0, TICKS_PER_SECOND)) {
+        std::cerr << "Unknown setting " << name << " in " << filename
+                  << std::endl;
+        return false;
+      }
+      GridAxis axis = {name, {}};
+      float value;
+      while (words >> value) {
+        axis.values.push_back(value);
+      }
+      if (axis.values.empty()) {
+        std::cerr << name << " in " << filename << " has no values"
+                  << std::endl;
+        return false;
+      }
+      settings.axes.push_back(axis);
+    }
+  }
+  if (settings.seeds < 1 || settings.ticks < 1) {
+    std::cerr << "SEEDS and TICKS have to be at least 1" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Every combination, the last axis changing fastest
+std::vector<GridPoint> BuildGrid(
+  const GridSettings& settings, const Properties& baseProperties
+) {
+  std::vector<GridPoint> points;
+  std::vector<size_t> at(settings.axes.size(), 0);
+  while (true) {
+    GridPoint point = {baseProperties, WavePacing(), {}};
+    for (size_t a = 0; a < settings.axes.size(); ++a) {
+      const GridAxis& axis = settings.axes[a];
+      float value = axis.values[at[a]];
+      point.values.push_back(value);
+      if (IsPacingSetting(axis.name)) {
+        SetPacing(point.pacing, axis.name, value);
+      } else {
+        SetProperty(&point.properties, axis.name, value, TICKS_PER_SECOND);
+      }
+    }
+    points.push_back(point);
+
+    size_t a = settings.axes.size();
+    while (a > 0 && ++at[a - 1] == settings.axes[a - 1].values.size()) {
+      at[a - 1] = 0;
+      --a;
+    }
+    if (a == 0) {
+      return points;
+    }
+  }
+}
+
+// A world of its own, level included, so nothing is shared with the other
+// threads but what's only read
+RunResult PlayWorld(
+  const GridPoint& point, uint32_t seed, long maxTicks, const Replay* replay
+) {
+  Level* level = Level::LoadLevel(LEVEL_FILENAME);
+  level->GeneratePaths();
+  World world(level, &point.properties, seed, point.pacing);
+  world.log = nullptr;
+  InputScript script((uint32_t)HashBytes(&seed, sizeof(seed)));
+
+  long ticks = maxTicks;
+  if (replay != nullptr) {
+    // The first seed plays the recording as it was, the others with
+    // different luck
+    replay->Begin(world);
+    if (seed > 1) {
+      world.Reseed(seed);
+    }
+    ticks = std::min(ticks, (long)replay->Ticks());
+  }
+
+  RunResult result = {0, 0, true, 0, 0};
+  double simulated = 0;
+  while (result.ticks < ticks) {
+    if (replay != nullptr) {
+      replay->BeginTick(result.ticks, world.input);
+    } else {
+      simulated += TIMESTEP;
+      script.BeginTick(world, simulated);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    world.Tick();
+    std::chrono::duration<double> took =
+      std::chrono::steady_clock::now() - start;
+    result.seconds += took.count();
+    result.worstTick = std::max(result.worstTick, took.count());
+    ++result.ticks;
+
+    if (world.player->health <= 0) {
+      result.survived = false;
+      break;
+    }
+  }
+  result.kills = world.player->kills;
+  return result;
+}
+
+double Percentile(std::vector<double> values, double fraction) {
+  std::sort(values.begin(), values.end());
+  return values[(size_t)(fraction * (values.size() - 1))];
+}
+
+int main(int argc, char* argv[]) {
+  SetTraceLogLevel(LOG_WARNING);
+
+  GridSettings settings;
+  if (argc > 2 || !LoadGrid(argc == 2 ? argv[1] : GRID_FILENAME, settings)) {
+    std::cerr << "Usage: simrunner [simgrid.cfg]" << std::endl;
+    return 2;
+  }
+
+  Properties* baseProperties =
+    LoadProperties(PROPERTIES_FILENAME, TICKS_PER_SECOND);
+  std::vector<GridPoint> points = BuildGrid(settings, *baseProperties);
+  delete baseProperties;
+
+  // Loaded here first so a missing level stops the run before any threads
+  // start, and to check the replay fits it. The world deletes the level.
+  Level* level = Level::LoadLevel(LEVEL_FILENAME);
+  level->GeneratePaths();
+  uint64_t levelHash = HashLevelLayout(level);
+  World check(level, &points[0].properties);
+  check.log = nullptr;
+  Replay replay;
+  if (!settings.replayFilename.empty() &&
+      (!replay.Load(settings.replayFilename.c_str(), levelHash) ||
+       !replay.Begin(check))) {
+    return 1;
+  }
+  const Replay* input = settings.replayFilename.empty() ? nullptr : &replay;
+
+  // Worlds are handed out one at a time, runs differ a lot in length
+  long worlds = (long)points.size() * settings.seeds;
+  std::vector<RunResult> results(worlds);
+  std::atomic<long> nextWorld{0};
+  std::atomic<long> finished{0};
+  int threadCount = settings.threads > 0
+                      ? settings.threads
+                      : std::max(1u, std::thread::hardware_concurrency());
+  std::cerr << "Playing " << worlds << " worlds, " << points.size()
+            << " combinations of " << settings.seeds << " seeds, on "
+            << threadCount << " threads" << std::endl;
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threadCount; ++t) {
+    threads.emplace_back([&] {
+      for (long w = nextWorld++; w < worlds; w = nextWorld++) {
+        uint32_t seed = (uint32_t)(w % settings.seeds) + 1;
+        results[w] = PlayWorld(
+          points[w / settings.seeds], seed, settings.ticks, input
+        );
+        ++finished;
+      }
+    });
+  }
+  long shown = 0;
+  while (finished < worlds) {
+    std::this_thread::sleep_for(
+      std::chrono::milliseconds(PROGRESS_INTERVAL_MS)
+    );
+    if (finished != shown) {
+      shown = finished;
+      std::cerr << "\r" << shown << " / " << worlds << std::flush;
+    }
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double> took = std::chrono::steady_clock::now() - start;
+
+  std::ofstream csv(RESULTS_FILENAME);
+  for (const GridAxis& axis : settings.axes) {
+    csv << axis.name << ",";
+  }
+  csv << "worlds,survived,survival_mean_s,survival_p10_s,survival_p50_s,"
+         "survival_p90_s,kills_mean,kills_max,tick_mean_us,tick_worst_us"
+      << std::endl;
+
+  long totalTicks = 0;
+  std::cout << std::endl;
+  for (size_t p = 0; p < points.size(); ++p) {
+    std::vector<double> survival;
+    long survived = 0;
+    long ticks = 0;
+    long kills = 0;
+    int mostKills = 0;
+    double seconds = 0;
+    double worstTick = 0;
+    for (long s = 0; s < settings.seeds; ++s) {
+      const RunResult& run = results[p * settings.seeds + s];
+      survival.push_back(run.ticks * TIMESTEP);
+      survived += run.survived;
+      ticks += run.ticks;
+      kills += run.kills;
+      mostKills = std::max(mostKills, run.kills);
+      seconds += run.seconds;
+      worstTick = std::max(worstTick, run.worstTick);
+    }
+    totalTicks += ticks;
+
+    double survivalMean = ticks * TIMESTEP / settings.seeds;
+    double p10 = Percentile(survival, 0.1);
+    double p50 = Percentile(survival, 0.5);
+    double p90 = Percentile(survival, 0.9);
+    double killsMean = (double)kills / settings.seeds;
+    double tickMean = ticks > 0 ? seconds / ticks * 1e6 : 0;
+    for (size_t a = 0; a < settings.axes.size(); ++a) {
+      std::cout << settings.axes[a].name << "=" << points[p].values[a] << " ";
+      csv << points[p].values[a] << ",";
+    }
+    std::cout << std::endl << std::fixed << std::setprecision(2)
+              << "  survived " << survived << " / " << settings.seeds
+              << ", survival mean " << survivalMean << " s, p10 " << p10
+              << " s, p50 " << p50 << " s, p90 " << p90 << " s" << std::endl
+              << "  kills mean " << killsMean << ", max " << mostKills
+              << ", tick mean " << tickMean << " us, worst "
+              << worstTick * 1e6 << " us" << std::endl
+              << std::defaultfloat << std::setprecision(6);
+    csv << settings.seeds << "," << survived << "," << survivalMean << ","
+        << p10 << "," << p50 << "," << p90 << "," << killsMean << ","
+        << mostKills << "," << tickMean << "," << worstTick * 1e6
+        << std::endl;
+  }
+
+  std::cout << worlds << " worlds, " << totalTicks << " ticks in "
+            << took.count() << " s, " << totalTicks / took.count()
+            << " ticks per second" << std::endl
+            << "Written to " << RESULTS_FILENAME << std::endl;
+  return 0;
+}
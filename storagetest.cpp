@@ -0,0 +1,353 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "headers/savegame.hpp"
+#include "headers/scorestore.hpp"
+#include "headers/snapshot.hpp"
+
+// Plays out crashes against the score store in a scratch folder and checks
+// that reopening it finds every run that was appended, no more and no
+// less. Then loads saves written by older and newer versions of the game.
+// Exits with 1 when a check fails.
+
+int failures = 0;
+
+void Check(bool passed, const std::string& what) {
+  if (!passed) {
+    std::cerr << "FAILED: " << what << std::endl;
+    ++failures;
+  }
+}
+
+bool SameRecord(const ScoreRecord& a, const ScoreRecord& b) {
+  return a.score == b.score && a.sequence == b.sequence &&
+         strncmp(a.name, b.name, SCORE_NAME_LENGTH) == 0;
+}
+
+bool SameRecords(
+  const std::vector<ScoreRecord>& a, const std::vector<ScoreRecord>& b
+) {
+  return a.size() == b.size() &&
+         std::equal(a.begin(), a.end(), b.begin(), SameRecord);
+}
+
+// Every query against what was appended, worked out the slow way
+void CheckStore(
+  const ScoreStore& store, std::vector<ScoreRecord> runs,
+  const std::string& when
+) {
+  std::sort(runs.begin(), runs.end(), RanksBefore);
+  Check(store.Count() == runs.size(), when + ": Count");
+  Check(SameRecords(store.TopK(runs.size() + 1), runs), when + ": TopK all");
+  std::vector<ScoreRecord> top(
+    runs.begin(), runs.begin() + std::min<size_t>(3, runs.size())
+  );
+  Check(SameRecords(store.TopK(3), top), when + ": TopK 3");
+
+  for (const ScoreRecord& run : runs) {
+    size_t above = std::count_if(
+      runs.begin(), runs.end(),
+      [&run](const ScoreRecord& r) { return r.score > run.score; }
+    );
+    Check(
+      store.RankOf(run.score) == above + 1,
+      when + ": RankOf " + std::to_string(run.score)
+    );
+
+    std::vector<ScoreRecord> same;
+    std::copy_if(
+      runs.begin(), runs.end(), std::back_inserter(same),
+      [&run](const ScoreRecord& r) {
+        return strncmp(r.name, run.name, SCORE_NAME_LENGTH) == 0;
+      }
+    );
+    Check(
+      SameRecords(store.ScoresOf(run.name), same),
+      when + ": ScoresOf " + run.name
+    );
+  }
+}
+
+void Append(
+  ScoreStore& store, std::vector<ScoreRecord>& runs, int score,
+  const char name[]
+) {
+  ScoreRecord record;
+  Check(store.Append(score, name, record), "Append");
+  runs.push_back(record);
+}
+
+void CheckScoreStore(const std::filesystem::path& folder) {
+  std::string log = (folder / "scores.log").string();
+  std::string index = (folder / "scores.idx").string();
+  std::vector<ScoreRecord> runs;
+  ScoreStore store;
+
+  Check(store.Open(log.c_str(), index.c_str()), "opening an empty store");
+  CheckStore(store, runs, "empty");
+  Append(store, runs, 30, "ada");
+  Append(store, runs, 10, "bo");
+  Append(store, runs, 50, "cy");
+  Append(store, runs, 10, "ada");
+  Append(store, runs, 40, "bo");
+  store.Close();
+
+  // A crash halfway through writing a record
+  ScoreLogRecord torn;
+  memset(&torn, 0xab, sizeof(ScoreLogRecord));
+  FILE* file = fopen(log.c_str(), "ab");
+  fwrite(&torn, sizeof(ScoreLogRecord) / 2, 1, file);
+  fclose(file);
+  store.Open(log.c_str(), index.c_str());
+  CheckStore(store, runs, "after a torn record");
+  Check(
+    std::filesystem::file_size(log) ==
+      sizeof(ScoreLogHeader) + runs.size() * sizeof(ScoreLogRecord),
+    "the torn record is cut off"
+  );
+  Append(store, runs, 20, "cy");
+  Append(store, runs, 50, "dee");
+  store.Close();
+  store.Open(log.c_str(), index.c_str());
+  CheckStore(store, runs, "appending after a torn record");
+
+  // What the files are between renaming the new index into place and
+  // starting the next log
+  std::string crashLog = log + ".crash";
+  std::string crashIndex = index + ".crash";
+  std::filesystem::copy_file(log, crashLog);
+  Check(store.Compact(), "Compact");
+  std::filesystem::copy_file(index, crashIndex);
+  std::vector<ScoreRecord> compacted = runs;
+  CheckStore(store, runs, "after compacting");
+  Append(store, runs, 60, "ada");
+  store.Close();
+  store.Open(log.c_str(), index.c_str());
+  CheckStore(store, runs, "reopened after compacting");
+
+  // Nothing was kept from before the first compaction
+  std::filesystem::rename(crashLog, log);
+  std::filesystem::rename(crashIndex, index);
+  std::filesystem::remove(log + ".old");
+  std::filesystem::remove(index + ".old");
+  store.Open(log.c_str(), index.c_str());
+  runs = compacted;
+  CheckStore(store, runs, "crashed before the new log");
+  Append(store, runs, 35, "bo");
+  store.Close();
+  store.Open(log.c_str(), index.c_str());
+  CheckStore(store, runs, "appending after that crash");
+  store.Close();
+
+  // A count far past what the file holds is caught before it's used
+  std::filesystem::copy_file(index, crashIndex);
+  uint64_t hugeCount = 1ull << 40;
+  file = fopen(index.c_str(), "r+b");
+  fseek(file, offsetof(ScoreIndexHeader, count), SEEK_SET);
+  fwrite(&hugeCount, sizeof(uint64_t), 1, file);
+  fclose(file);
+  store.Open(log.c_str(), index.c_str());
+  CheckStore(store, runs, "with a damaged index count");
+  store.Close();
+  std::filesystem::rename(crashIndex, index);
+
+  // Still in that state the log holds every run, so a damaged index with
+  // nothing to fall back on loses nothing
+  file = fopen(index.c_str(), "r+b");
+  fseek(file, sizeof(ScoreIndexHeader) + 4, SEEK_SET);
+  fputc(0xff, file);
+  fclose(file);
+  store.Open(log.c_str(), index.c_str());
+  CheckStore(store, runs, "with a damaged index");
+  Append(store, runs, 5, "eve");
+  CheckStore(store, runs, "appending with a damaged index");
+
+  // Usually the log only holds the runs since the last compaction, so a
+  // damaged index falls back to the one before it and both logs since
+  Check(store.Compact(), "Compact after a damaged index");
+  Append(store, runs, 45, "fay");
+  Append(store, runs, 15, "ada");
+  Check(store.Compact(), "Compact again");
+  Append(store, runs, 25, "gus");
+  store.Close();
+  file = fopen(index.c_str(), "r+b");
+  fseek(file, sizeof(ScoreIndexHeader) + 4, SEEK_SET);
+  fputc(0xff, file);
+  fclose(file);
+  store.Open(log.c_str(), index.c_str());
+  CheckStore(store, runs, "with a damaged index after compacting");
+  Append(store, runs, 55, "hal");
+  Check(store.Compact(), "Compact after falling back");
+  store.Close();
+  store.Open(log.c_str(), index.c_str());
+  CheckStore(store, runs, "compacted after falling back");
+  store.Close();
+}
+
+// Distinct bytes, so a field read from the wrong place shows
+template <typename T>
+T Filled(unsigned char first) {
+  T record;
+  unsigned char* bytes = (unsigned char*)&record;
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    bytes[i] = first + i;
+  }
+  return record;
+}
+
+void AddSection(
+  std::vector<unsigned char>& bytes, uint32_t tag, uint32_t recordSize,
+  uint32_t count, const void* records
+) {
+  SaveSection section = {tag, recordSize, count, 0};
+  size_t at = bytes.size();
+  bytes.resize(at + sizeof(SaveSection) + (size_t)recordSize * count);
+  memcpy(&bytes[at], &section, sizeof(SaveSection));
+  if (recordSize > 0) {
+    memcpy(
+      &bytes[at + sizeof(SaveSection)], records, (size_t)recordSize * count
+    );
+  }
+}
+
+void FinishSave(
+  std::vector<unsigned char>& bytes, uint32_t sections, uint64_t levelHash,
+  uint16_t version, uint16_t readableSince
+) {
+  SaveHeader header;
+  memset(&header, 0, sizeof(SaveHeader));
+  memcpy(header.magic, SAVE_MAGIC, 4);
+  header.version = version;
+  header.readableSince = readableSince;
+  header.sections = sections;
+  header.levelHash = levelHash;
+  header.checksum =
+    HashBytes(&bytes[sizeof(SaveHeader)], bytes.size() - sizeof(SaveHeader));
+  memcpy(&bytes[0], &header, sizeof(SaveHeader));
+}
+
+void CheckSaveFormat() {
+  const uint64_t levelHash = 1234;
+  WorldRecord world = Filled<WorldRecord>(1);
+  world.meleeEnemies = 2;
+  world.rangedEnemies = 0;
+  world.bullets = 0;
+  world.items = 0;
+  world.obstacles = 0;
+  world.inAttackAnimation = true;
+  world.canSwing = false;
+  PlayerRecord player = Filled<PlayerRecord>(2);
+  player.isGrounded = true;
+  player.facingLeft = false;
+  MeleeEnemyRecord melee[2] = {
+    Filled<MeleeEnemyRecord>(3), Filled<MeleeEnemyRecord>(4)
+  };
+  for (MeleeEnemyRecord& m : melee) {
+    m.active = m.isMovingLeft = m.isGrounded = true;
+    m.isMovingRight = m.isJumping = m.isFollowingPlayer = false;
+  }
+
+  WorldSnapshot snapshot;
+  snapshot.Write(world);
+  snapshot.Write(player);
+  snapshot.Write(melee[0]);
+  snapshot.Write(melee[1]);
+
+  std::vector<unsigned char> bytes;
+  WorldSnapshot loaded;
+  EncodeSave(snapshot, levelHash, bytes);
+  Check(DecodeSave(bytes, levelHash, loaded), "loading a save");
+  Check(loaded.bytes == snapshot.bytes, "a save loads as it was saved");
+  Check(!DecodeSave(bytes, levelHash + 1, loaded), "another level's save");
+  bytes[bytes.size() / 2] ^= 1;
+  Check(!DecodeSave(bytes, levelHash, loaded), "a damaged save");
+
+  // Version 1 had no staggerPhase or cameraTarget. A newer version adds a
+  // field to melee enemies and a section this one doesn't know, and lists
+  // the sections in another order.
+  const uint32_t oldWorldSize = offsetof(WorldRecord, staggerPhase);
+  const uint32_t newMeleeSize = sizeof(MeleeEnemyRecord) + 8;
+  std::vector<unsigned char> newMelee(2 * newMeleeSize, 0x77);
+  memcpy(&newMelee[0], &melee[0], sizeof(MeleeEnemyRecord));
+  memcpy(&newMelee[newMeleeSize], &melee[1], sizeof(MeleeEnemyRecord));
+  const unsigned char unknown[3 * 12] = {9, 9, 9};
+
+  bytes.assign(sizeof(SaveHeader), 0);
+  AddSection(bytes, SAVE_MELEE_ENEMIES, newMeleeSize, 2, newMelee.data());
+  AddSection(bytes, 42, 12, 3, unknown);
+  AddSection(bytes, SAVE_WORLD, oldWorldSize, 1, &world);
+  AddSection(bytes, SAVE_PLAYER, sizeof(PlayerRecord), 1, &player);
+  FinishSave(bytes, 4, levelHash, SAVE_VERSION + 1, 1);
+  Check(DecodeSave(bytes, levelHash, loaded), "loading another version");
+
+  WorldRecord expected = world;
+  expected.staggerPhase = 0;
+  expected.cameraTarget = {0, 0};
+  snapshot.Clear();
+  snapshot.Write(expected);
+  snapshot.Write(player);
+  snapshot.Write(melee[0]);
+  snapshot.Write(melee[1]);
+  Check(
+    loaded.bytes == snapshot.bytes,
+    "missing fields load as 0, unknown fields and sections are skipped"
+  );
+
+  FinishSave(bytes, 4, levelHash, SAVE_VERSION + 1, SAVE_VERSION + 1);
+  Check(
+    !DecodeSave(bytes, levelHash, loaded),
+    "a save this version can't make sense of"
+  );
+
+  // Counts no game reaches, with records too small for the file to run
+  // out first
+  bytes.assign(sizeof(SaveHeader), 0);
+  AddSection(bytes, SAVE_WORLD, sizeof(WorldRecord), 1, &world);
+  AddSection(bytes, SAVE_PLAYER, sizeof(PlayerRecord), 1, &player);
+  AddSection(bytes, SAVE_BULLETS, 0, 0xffffffff, nullptr);
+  FinishSave(bytes, 3, levelHash, SAVE_VERSION, 1);
+  Check(!DecodeSave(bytes, levelHash, loaded), "empty records");
+
+  std::vector<BulletRecord> bullets(SAVE_MAX_ENTITIES + 1);
+  bytes.assign(sizeof(SaveHeader), 0);
+  AddSection(bytes, SAVE_WORLD, sizeof(WorldRecord), 1, &world);
+  AddSection(bytes, SAVE_PLAYER, sizeof(PlayerRecord), 1, &player);
+  AddSection(
+    bytes, SAVE_BULLETS, sizeof(BulletRecord), bullets.size(), bullets.data()
+  );
+  FinishSave(bytes, 3, levelHash, SAVE_VERSION, 1);
+  Check(!DecodeSave(bytes, levelHash, loaded), "too many bullets");
+
+  std::vector<MeleeEnemyRecord> pool(MELEE_ENEMY_SPAWN_COUNT + 1, melee[0]);
+  bytes.assign(sizeof(SaveHeader), 0);
+  AddSection(bytes, SAVE_WORLD, sizeof(WorldRecord), 1, &world);
+  AddSection(bytes, SAVE_PLAYER, sizeof(PlayerRecord), 1, &player);
+  AddSection(
+    bytes, SAVE_MELEE_ENEMIES, sizeof(MeleeEnemyRecord), pool.size(),
+    pool.data()
+  );
+  FinishSave(bytes, 3, levelHash, SAVE_VERSION, 1);
+  Check(!DecodeSave(bytes, levelHash, loaded), "more melee than the pool");
+}
+
+int main() {
+  std::filesystem::path folder =
+    std::filesystem::temp_directory_path() / "hakenslash_storagetest";
+  std::filesystem::remove_all(folder);
+  std::filesystem::create_directories(folder);
+
+  CheckScoreStore(folder);
+  CheckSaveFormat();
+
+  std::filesystem::remove_all(folder);
+  std::cout << (failures == 0 ? "All storage checks passed" : "Failed")
+            << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -22,9 +22,11 @@ int main() {
     InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE);
     SetTargetFPS(TARGET_FPS);
 
-    Texture heartFull = LoadTexture("./assets/Heart_Full.png");
-    Texture heartHalf = LoadTexture("./assets/Heart_Half.png");
-    Texture heartEmpty = LoadTexture("./assets/Heart_Empty.png");
+    AssetManager assets;
+    assets.Start();
+    SpriteAtlas atlas;
+    atlas.Load(ATLAS_TABLE_FILENAME, &assets);
+    assets.WaitAll();
 
     menuHandler.inGameGUI.hpBar.InitBar(20);
 
@@ -37,10 +39,10 @@ int main() {
             menuHandler.inGameGUI.hpBar.UpdateHealth(-1);
         }
 
-        std::cout << currentGameState << std::endl;
-        menuHandler.inGameGUI.hpBar.heart_full = heartFull;
-        menuHandler.inGameGUI.hpBar.heart_half = heartHalf;
-        menuHandler.inGameGUI.hpBar.heart_empty = heartEmpty;
+        std::cout << menuHandler.getState() << std::endl;
+        menuHandler.inGameGUI.hpBar.SetHearts(
+            atlas.Get(SPRITE_HEART_FULL), atlas.Get(SPRITE_HEART_HALF),
+            atlas.Get(SPRITE_HEART_EMPTY));
 
         state = menuHandler.getState();
         menuHandler.Update();
@@ -51,9 +53,9 @@ int main() {
         EndDrawing();
     }
 
-    UnloadTexture(heartFull);
-    UnloadTexture(heartHalf);
-    UnloadTexture(heartEmpty);
+    menuHandler.Unload();
+    atlas.Unload();
+    assets.Shutdown();
 
     CloseWindow();
 